@@ -0,0 +1,103 @@
+#include <string.h> /* memcmp, memset */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "corpus.h"
+
+static unsigned long long read_little(const unsigned char *bytes, int length);
+static void write_little(unsigned char *bytes, int length, unsigned long long value);
+
+/* Map the corpus at `path` read only. Returns 0 on success, -1 if the file
+ * can't be read or isn't a corpus this code understands */
+int open_corpus(Corpus *corpus, const char *path) {
+	struct stat info;
+	const unsigned char *header;
+	unsigned long long count;
+	int fd = open(path, O_RDONLY);
+
+	if(fd < 0)
+		return -1;
+	if(fstat(fd, &info) < 0 || (size_t) info.st_size < CORPUS_HEADER) {
+		close(fd);
+		return -1;
+	}
+	corpus->map_size = info.st_size;
+	corpus->map = mmap(NULL, corpus->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(corpus->map == MAP_FAILED)
+		return -1;
+
+	header = corpus->map;
+	count = read_little(header + 16, 8);
+	if(memcmp(header, CORPUS_MAGIC, 4) != 0
+	   || read_little(header + 4, 2) != CORPUS_VERSION
+	   || read_little(header + 6, 2) != CORPUS_RECORD
+	   || count > (corpus->map_size - CORPUS_HEADER) / CORPUS_RECORD) {
+		munmap(corpus->map, corpus->map_size);
+		return -1;
+	}
+
+	corpus->records = header + CORPUS_HEADER;
+	corpus->count = (size_t) count;
+	return 0;
+}
+
+void close_corpus(Corpus *corpus) {
+	munmap(corpus->map, corpus->map_size);
+}
+
+/* Puzzle number `index` as 81 digits, '0' for empty cells. `puzzle` needs
+ * room for 82 characters */
+void corpus_puzzle(const Corpus *corpus, size_t index, char *puzzle) {
+	unpack_puzzle(corpus->records + index * CORPUS_RECORD, puzzle);
+}
+
+/* Digits 1 to 9 are clues, anything else is an empty cell */
+void pack_puzzle(const char *puzzle, unsigned char *record) {
+	int i, digit;
+
+	memset(record, 0, CORPUS_RECORD);
+	for(i = 0; i < 81; i++) {
+		digit = (puzzle[i] > '0' && puzzle[i] <= '9') ? puzzle[i] - '0' : 0;
+		record[i/2] |= digit << (4 * (i % 2));
+	}
+}
+
+void unpack_puzzle(const unsigned char *record, char *puzzle) {
+	int i;
+
+	for(i = 0; i < 81; i++)
+		puzzle[i] = '0' + ((record[i/2] >> (4 * (i % 2))) & 0xF);
+	puzzle[81] = '\0';
+}
+
+/* Write the header at the current position of `out`. Returns 0 on success */
+int write_corpus_header(FILE *out, size_t count) {
+	unsigned char header[CORPUS_HEADER];
+
+	memset(header, 0, CORPUS_HEADER);
+	memcpy(header, CORPUS_MAGIC, 4);
+	write_little(header + 4, 2, CORPUS_VERSION);
+	write_little(header + 6, 2, CORPUS_RECORD);
+	write_little(header + 16, 8, count);
+	return fwrite(header, CORPUS_HEADER, 1, out) == 1 ? 0 : -1;
+}
+
+static unsigned long long read_little(const unsigned char *bytes, int length) {
+	unsigned long long value = 0;
+
+	while(length-- > 0)
+		value = (value << 8) | bytes[length];
+	return value;
+}
+
+static void write_little(unsigned char *bytes, int length, unsigned long long value) {
+	int i;
+
+	for(i = 0; i < length; i++) {
+		bytes[i] = value & 0xFF;
+		value >>= 8;
+	}
+}
@@ -0,0 +1,33 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+#include <stddef.h>
+#include <stdio.h>
+
+/* Packed puzzle corpus. A 32 byte header
+ *     "SBPZ", version (2 bytes), record size (2 bytes), 8 reserved bytes,
+ *     puzzle count (8 bytes), 8 reserved bytes
+ * (all numbers little endian) is followed by one fixed size record per
+ * puzzle: cell i is the low (i even) or high (i odd) nibble of byte i/2,
+ * 0 for empty. Puzzle n is at a known offset, so the file can be mapped and
+ * split between readers without parsing anything. */
+
+#define CORPUS_MAGIC "SBPZ"
+#define CORPUS_VERSION 1
+#define CORPUS_HEADER 32
+#define CORPUS_RECORD 41
+
+typedef struct {
+	const unsigned char *records;
+	size_t count;
+	void *map;
+	size_t map_size;
+} Corpus;
+
+int open_corpus(Corpus *corpus, const char *path);
+void close_corpus(Corpus *corpus);
+void corpus_puzzle(const Corpus *corpus, size_t index, char *puzzle);
+void pack_puzzle(const char *puzzle, unsigned char *record);
+void unpack_puzzle(const unsigned char *record, char *puzzle);
+int write_corpus_header(FILE *out, size_t count);
+
+#endif
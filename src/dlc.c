@@ -0,0 +1,243 @@
+#include "dlc.h"
+#include "dlx_config.h"
+#include <stdlib.h>
+#include <limits.h>
+
+static void hide_option(Cells *cells, int cell);
+static void unhide_option(Cells *cells, int cell);
+
+/* Take a snapshot of what is left on a dance floor: the columns still to be
+ * covered and the rows still linked in them. The floor is only read (column
+ * sizes are borrowed while building and put back), and has to outlive the
+ * result because callbacks are handed its columns and nodes */
+Cells *cells_from_dlx(Control *master) {
+	Cells *cells = malloc(sizeof(Cells));
+	Control *column;
+	Node *row, *j;
+	int items = 0, cell_count = 0, option_count = 0;
+	int i, c, o, fresh;
+
+	for(column = master->right; column != master; column = column->right) {
+		items++;
+		cell_count += column->size;
+	}
+
+	cells->items = items;
+	cells->active = items;
+	cells->item = malloc(items*sizeof(int));
+	cells->item_pos = malloc(items*sizeof(int));
+	cells->start = malloc(items*sizeof(int));
+	cells->size = malloc(items*sizeof(int));
+	cells->controls = malloc(items*sizeof(Control *));
+	cells->set = malloc(cell_count*sizeof(int));
+	cells->set_pos = malloc(cell_count*sizeof(int));
+	cells->cell_item = malloc(cell_count*sizeof(int));
+	cells->cell_option = malloc(cell_count*sizeof(int));
+	cells->nodes = malloc(cell_count*sizeof(Node *));
+	/* no option has fewer than one cell */
+	cells->option_start = malloc((cell_count + 1)*sizeof(int));
+
+	/* Columns lend their size field to hold their item number meanwhile */
+	i = 0;
+	c = 0;
+	for(column = master->right; column != master; column = column->right) {
+		cells->item[i] = i;
+		cells->item_pos[i] = i;
+		cells->start[i] = c;
+		cells->size[i] = 0;
+		cells->controls[i] = column;
+		c += column->size;
+		column->size = i;
+		i++;
+	}
+
+	/* Every row is still linked in all of its columns, so take it from the
+	 * first of them, in floor order */
+	c = 0;
+	for(i = 0; i < items; i++) {
+		column = cells->controls[i];
+		for(row = column->node.down; row != &(column->node); row = row->down) {
+			fresh = 1;
+			j = row;
+			do {
+				if(j->control->size < i)
+					fresh = 0;
+				j = j->right;
+			} while(j != row);
+			if(!fresh)
+				continue;
+
+			cells->option_start[option_count] = c;
+			j = row;
+			do {
+				o = j->control->size;
+				cells->cell_item[c] = o;
+				cells->cell_option[c] = option_count;
+				cells->nodes[c] = j;
+				cells->set_pos[c] = cells->start[o] + cells->size[o];
+				cells->set[cells->set_pos[c]] = c;
+				cells->size[o]++;
+				c++;
+				j = j->right;
+			} while(j != row);
+			option_count++;
+		}
+	}
+	cells->option_start[option_count] = c;
+
+	for(i = 0; i < items; i++)
+		cells->controls[i]->size = cells->size[i];
+
+	return cells;
+}
+
+void free_cells(Cells *cells) {
+	free(cells->item);
+	free(cells->item_pos);
+	free(cells->start);
+	free(cells->size);
+	free(cells->controls);
+	free(cells->set);
+	free(cells->set_pos);
+	free(cells->cell_item);
+	free(cells->cell_option);
+	free(cells->nodes);
+	free(cells->option_start);
+	free(cells);
+}
+
+/* Same contract as solve_dlx, callbacks included: columns and rows handed to
+ * them are the ones of the floor the cells were taken from (with the column
+ * size brought up to date for the duration of the call), and acc is filled
+ * with the node of each chosen row that lies in the chosen column */
+int solve_cells(Cells *cells, int iteration, Node *acc[],
+                void (*column_chosen_callback)(const Control *, int, void *),
+                void (*row_chosen_callback)(const Node *, int, void *),
+                void (*solution_callback)(Node * [], int, void *),
+                void *callback_data) {
+	int item, k, cell, first, last, j, floor_size;
+
+	if(cells->active == 0) {
+		if(solution_callback != NULL)
+			solution_callback(acc, iteration, callback_data);
+		return 1;
+	}
+
+	item = choose_item(cells);
+	if(column_chosen_callback != NULL) {
+		/* the floor's own count is stale, lend it ours for the call */
+		floor_size = cells->controls[item]->size;
+		cells->controls[item]->size = cells->size[item];
+		column_chosen_callback(cells->controls[item], iteration, callback_data);
+		cells->controls[item]->size = floor_size;
+	}
+	cover_item(cells, item);
+	for(k = 0; k < cells->size[item]; k++) {
+		cell = cells->set[cells->start[item] + k];
+		if(row_chosen_callback != NULL)
+			row_chosen_callback(cells->nodes[cell], iteration, callback_data);
+		acc[iteration] = cells->nodes[cell];
+		first = cells->option_start[cells->cell_option[cell]];
+		last = cells->option_start[cells->cell_option[cell] + 1];
+		for(j = first; j < last; j++) {
+			if(j != cell)
+				cover_item(cells, cells->cell_item[j]);
+		}
+
+#ifdef DLX_EXHAUSTIVE
+		solve_cells(cells, iteration + 1, acc,
+		            column_chosen_callback,
+		            row_chosen_callback,
+		            solution_callback, callback_data);
+#else
+		if(solve_cells(cells, iteration + 1, acc,
+		               column_chosen_callback,
+		               row_chosen_callback,
+		               solution_callback, callback_data))
+			return 1;
+#endif
+
+		for(j = last - 1; j >= first; j--) {
+			if(j != cell)
+				uncover_item(cells, cells->cell_item[j]);
+		}
+	}
+
+	uncover_item(cells, item);
+	return 0;
+}
+
+/* The active item with the fewest options left */
+int choose_item(const Cells *cells) {
+	int ret = cells->item[0];
+	int s = INT_MAX;
+	int k, item;
+
+	for(k = 0; k < cells->active; k++) {
+		item = cells->item[k];
+		if(cells->size[item] < s) {
+			ret = item;
+			s = cells->size[item];
+		}
+	}
+	return ret;
+}
+
+void cover_item(Cells *cells, int item) {
+	int pos = cells->item_pos[item];
+	int last = cells->item[cells->active - 1];
+	int k;
+
+	/* swap the item past the active ones */
+	cells->item[pos] = last;
+	cells->item_pos[last] = pos;
+	cells->item[cells->active - 1] = item;
+	cells->item_pos[item] = cells->active - 1;
+	cells->active--;
+
+	for(k = 0; k < cells->size[item]; k++)
+		hide_option(cells, cells->set[cells->start[item] + k]);
+}
+
+/* Undo cover_item. Must be called in the reverse order of covering */
+void uncover_item(Cells *cells, int item) {
+	int k;
+
+	for(k = cells->size[item] - 1; k >= 0; k--)
+		unhide_option(cells, cells->set[cells->start[item] + k]);
+	cells->active++;
+}
+
+/* Take the option of `cell` out of the sets of its other items */
+static void hide_option(Cells *cells, int cell) {
+	int option = cells->cell_option[cell];
+	int first = cells->option_start[option];
+	int last = cells->option_start[option + 1];
+	int j, item, pos, end, other;
+
+	for(j = first; j < last; j++) {
+		if(j == cell)
+			continue;
+		item = cells->cell_item[j];
+		pos = cells->set_pos[j];
+		end = cells->start[item] + cells->size[item] - 1;
+		other = cells->set[end];
+		cells->set[end] = j;
+		cells->set_pos[j] = end;
+		cells->set[pos] = other;
+		cells->set_pos[other] = pos;
+		cells->size[item]--;
+	}
+}
+
+static void unhide_option(Cells *cells, int cell) {
+	int option = cells->cell_option[cell];
+	int first = cells->option_start[option];
+	int last = cells->option_start[option + 1];
+	int j;
+
+	for(j = last - 1; j >= first; j--) {
+		if(j != cell)
+			cells->size[cells->cell_item[j]]++;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef DLC_H
+#define DLC_H
+#include "dlx.h"
+
+/* Exact cover with sparse sets ("dancing cells") instead of doubly linked
+ * lists. Every item (column) keeps the cells of its options in one stretch
+ * of `set`, the options still available first. Hiding an option swaps it
+ * past the end of the available ones and shrinks the size, and undoing that
+ * is just growing the size back, since the swapped cell is still there. */
+typedef struct {
+	int items;         /* number of items */
+	int active;        /* item[0 .. active - 1] still have to be covered */
+	int *item;         /* the items, active ones first */
+	int *item_pos;     /* where each item is in `item` */
+	int *start;        /* each item's cells are set[start .. start + size - 1] */
+	int *size;         /* how many of them are still available */
+	int *set;          /* cell numbers, grouped by item */
+	int *set_pos;      /* where each cell is in `set` */
+	int *cell_item;    /* the item each cell belongs to */
+	int *cell_option;  /* the option each cell belongs to */
+	int *option_start; /* option o is cells option_start[o] .. option_start[o+1]-1 */
+	Control **controls; /* column each item was made from, for the callbacks */
+	Node **nodes;      /* node each cell was made from */
+} Cells;
+
+Cells *cells_from_dlx(Control *master);
+void free_cells(Cells *cells);
+int solve_cells(Cells *cells, int iteration, Node *acc[],
+                void (*column_chosen_callback)(const Control *, int, void *),
+                void (*row_chosen_callback)(const Node *, int, void *),
+                void (*solution_callback)(Node * [], int, void *),
+                void *callback_data);
+int choose_item(const Cells *cells);
+void cover_item(Cells *cells, int item);
+void uncover_item(Cells *cells, int item);
+
+#endif
@@ -4,6 +4,13 @@
 #include <stdio.h>
 #include <limits.h>
 
+/* Room for columns waiting to be looked at by propagate_dlx */
+#define PROPAGATE_PENDING 64
+
+static void cover_column_noting(Control *column, Control *pending[],
+                                int *count, int *overflow);
+static void note_forced(Control *column, Control *pending[], int *count, int *overflow);
+
 /* Construct the dancing floor from a m by n matrix of 1's or 0's 
    The matrix is a simple array, listing the entries from left to right
    top to bottom. The labels array is an array of length n to label the
@@ -158,6 +165,87 @@ int solve_dlx(Control *master, int iteration, Node *acc[],
 	return 0;
 }
 
+/* Preprocessing for solve_dlx: as long as some column has a single row left
+ * that row is forced, so cover it straight away instead of recursing on it.
+ * Rather than looking through every column for the next forced one, the
+ * columns whose size drops to 1 or 0 while covering are noted down, so the
+ * whole floor is only looked through once (again only if more columns are
+ * noted than there is room for). Forced rows are appended to acc from
+ * `iteration` on and reported through the callbacks as solve_dlx would
+ * report them, though not necessarily in the order it would choose them.
+ * Stops at an empty column, leaving solve_dlx to backtrack on it.
+ * Returns the iteration the branching search should start from. Nothing is
+ * undone here: the caller has to uncover acc[iteration - 1] down to the
+ * starting point once done */
+int propagate_dlx(Control *master, int iteration, Node *acc[],
+                  void (*column_chosen_callback)(const Control *, int, void *),
+                  void (*row_chosen_callback)(const Node *, int, void *),
+                  void *callback_data) {
+	Control *pending[PROPAGATE_PENDING];
+	int count = 0, overflow = 1;
+	Control *column = NULL;
+	Node *row = NULL, *j = NULL;
+
+	for(;;) {
+		if(count == 0) {
+			if(!overflow)
+				break;
+			overflow = 0;
+			for(column = master->right; column != master; column = column->right)
+				note_forced(column, pending, &count, &overflow);
+			if(count == 0)
+				break;
+		}
+		column = pending[--count];
+		/* it may have been covered, or lost its last row, since */
+		if(column->left->right != column)
+			continue;
+		if(column->size == 0)
+			break;
+		if(column->size != 1)
+			continue;
+		row = column->node.down;
+		if(column_chosen_callback != NULL)
+			column_chosen_callback(column, iteration, callback_data);
+		if(row_chosen_callback != NULL)
+			row_chosen_callback(row, iteration, callback_data);
+		cover_column_noting(column, pending, &count, &overflow);
+		acc[iteration] = row;
+		iteration++;
+		for(j = row->right; j != row; j = j->right)
+			cover_column_noting(j->control, pending, &count, &overflow);
+	}
+	return iteration;
+}
+
+/* cover_column, noting down the columns left with a single row or none */
+static void cover_column_noting(Control *column, Control *pending[],
+                                int *count, int *overflow) {
+	Node *i = NULL, *j = NULL;
+
+	column->left->right = column->right;
+	column->right->left = column->left;
+
+	for(i = column->node.down; i != &(column->node); i = i->down) {
+		for(j = i->right; j != i; j = j->right) {
+			j->up->down = j->down;
+			j->down->up = j->up;
+			j->control->size -= 1;
+			if(j->control->size <= 1)
+				note_forced(j->control, pending, count, overflow);
+		}
+	}
+}
+
+static void note_forced(Control *column, Control *pending[], int *count, int *overflow) {
+	if(column->size > 1)
+		return;
+	if(*count < PROPAGATE_PENDING)
+		pending[(*count)++] = column;
+	else
+		*overflow = 1;
+}
+
 void print_solution(Node *acc[], int iteration) {
 	int i;
 	Node *row, *j;
@@ -211,6 +299,31 @@ void uncover_row(Node *row) {
 	uncover_column(row->control);
 }
 
+/* Take a row off the floor without choosing it, as if it never was an
+ * option. unhide_row puts it back; as with columns, rows have to be put
+ * back in the reverse order they were hidden */
+void hide_row(Node *row) {
+	Node *j = row;
+
+	do {
+		j->up->down = j->down;
+		j->down->up = j->up;
+		j->control->size -= 1;
+		j = j->right;
+	} while(j != row);
+}
+
+void unhide_row(Node *row) {
+	Node *j = row->left;
+
+	do {
+		j->control->size += 1;
+		j->up->down = j;
+		j->down->up = j;
+		j = j->left;
+	} while(j != row->left);
+}
+
 void cover_column(Control* column) {
 	Node *i = NULL, *j = NULL;
 	
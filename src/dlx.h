@@ -22,10 +22,16 @@ int solve_dlx(Control *master, int iteration, Node *acc[],
                void (*row_chosen_callback)(const Node *, int, void *),
                void (*solution_callback)(Node * [], int, void *),
                void *callback_data);
+int propagate_dlx(Control *master, int iteration, Node *acc[],
+                  void (*column_chosen_callback)(const Control *, int, void *),
+                  void (*row_chosen_callback)(const Node *, int, void *),
+                  void *callback_data);
 void print_solution(Node *acc[], int iteration);
 Control *choose_column(Control *master);
 void cover_row(Node *row);
 void uncover_row(Node *row);
+void hide_row(Node *row);
+void unhide_row(Node *row);
 void cover_column(Control*);
 void uncover_column(Control*);
 
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h> /* strlen, strcpy, strcat */
+#include <errno.h>
+
+#include "dlx_checkpoint.h"
+#include "dlx_config.h"
+#include "dlx.h"
+
+/* Looking at the clock on every node would cost more than the dance */
+#define CLOCK_EVERY 16384
+
+static int dance(Control *master, int iteration, Node *acc[],
+                 void (*column_chosen_callback)(const Control *, int, void *),
+                 void (*row_chosen_callback)(const Node *, int, void *),
+                 void (*solution_callback)(Node * [], int, void *),
+                 void *callback_data, DlxCheckpoint *checkpoint);
+
+/* `levels` is the deepest the search can go below its starting point */
+DlxCheckpoint *new_dlx_checkpoint(const char *path, int interval, int levels) {
+	DlxCheckpoint *checkpoint = malloc(sizeof(DlxCheckpoint));
+
+	checkpoint->path = path;
+	checkpoint->interval = interval;
+	checkpoint->last_save = time(NULL);
+	checkpoint->nodes = 0;
+	checkpoint->tag = 0;
+	checkpoint->solutions = 0;
+	checkpoint->start = 0;
+	checkpoint->levels = levels;
+	checkpoint->names = malloc(levels * sizeof(int));
+	checkpoint->ordinals = malloc(levels * sizeof(int));
+	checkpoint->resume = 0;
+	checkpoint->flush = NULL;
+	checkpoint->flush_data = NULL;
+	checkpoint->error = 0;
+	return checkpoint;
+}
+
+void free_dlx_checkpoint(DlxCheckpoint *checkpoint) {
+	free(checkpoint->names);
+	free(checkpoint->ordinals);
+	free(checkpoint);
+}
+
+/* Read the checkpoint file, if there is one, so that the next search
+ * continues where the saved one was. Returns 1 if a checkpoint was loaded,
+ * 0 if there is no file and -1 if the file can't be understood */
+int load_dlx_checkpoint(DlxCheckpoint *checkpoint) {
+	FILE *in = fopen(checkpoint->path, "r");
+	int version, depth, i;
+
+	if(in == NULL)
+		return 0;
+	if(fscanf(in, "sudoku-beast checkpoint %d", &version) != 1 || version != 1
+	   || fscanf(in, " tag %ld", &checkpoint->tag) != 1
+	   || fscanf(in, " solutions %llu", &checkpoint->solutions) != 1
+	   || fscanf(in, " depth %d", &depth) != 1
+	   || depth < 0 || depth > checkpoint->levels) {
+		fclose(in);
+		return -1;
+	}
+	for(i = 0; i < depth; i++) {
+		if(fscanf(in, "%d %d", checkpoint->names + i, checkpoint->ordinals + i) != 2) {
+			fclose(in);
+			return -1;
+		}
+	}
+	fclose(in);
+	checkpoint->resume = depth;
+	return 1;
+}
+
+/* Save the first `depth` levels of the current path. The file is written
+ * next to its final place and renamed over it, so a process killed halfway
+ * leaves the previous checkpoint intact. Returns 0 on success, -1 if it
+ * couldn't be written */
+int save_dlx_checkpoint(DlxCheckpoint *checkpoint, int depth) {
+	char *temporary = malloc(strlen(checkpoint->path) + 5);
+	FILE *out;
+	int i, failed;
+
+	/* whatever the solutions found so far went to has to be safe before the
+	 * checkpoint says they were found */
+	if(checkpoint->flush != NULL && checkpoint->flush(checkpoint->flush_data) != 0) {
+		free(temporary);
+		return -1;
+	}
+	strcpy(temporary, checkpoint->path);
+	strcat(temporary, ".tmp");
+	out = fopen(temporary, "w");
+	if(out == NULL) {
+		free(temporary);
+		return -1;
+	}
+
+	fprintf(out, "sudoku-beast checkpoint 1\n");
+	fprintf(out, "tag %ld\n", checkpoint->tag);
+	fprintf(out, "solutions %llu\n", checkpoint->solutions);
+	fprintf(out, "depth %d\n", depth);
+	for(i = 0; i < depth; i++)
+		fprintf(out, "%d %d\n", checkpoint->names[i], checkpoint->ordinals[i]);
+
+	failed = ferror(out);
+	failed |= fclose(out);
+	if(!failed)
+		failed = rename(temporary, checkpoint->path);
+	free(temporary);
+	return failed ? -1 : 0;
+}
+
+/* solve_dlx, saving where it is every `interval` seconds. If a checkpoint
+ * was loaded, the saved path is covered again first (callbacks are called
+ * for it as if it was being searched) and the search goes on from the node
+ * it was at: everything before it has been searched already, and is counted
+ * in `checkpoint->solutions`. Returns DLX_CHECKPOINT_MISMATCH if the saved
+ * path doesn't fit this floor, and DLX_CHECKPOINT_UNSAVED (with errno in
+ * `checkpoint->error`) as soon as a save fails: a search that can't be
+ * picked up again shouldn't go on as if it could. Otherwise it returns what
+ * solve_dlx would. The floor is left as solve_dlx leaves it */
+int solve_dlx_checkpointed(Control *master, int iteration, Node *acc[],
+                           void (*column_chosen_callback)(const Control *, int, void *),
+                           void (*row_chosen_callback)(const Node *, int, void *),
+                           void (*solution_callback)(Node * [], int, void *),
+                           void *callback_data, DlxCheckpoint *checkpoint) {
+	checkpoint->start = iteration;
+	checkpoint->nodes = 0;
+	return dance(master, iteration, acc,
+	             column_chosen_callback, row_chosen_callback,
+	             solution_callback, callback_data, checkpoint);
+}
+
+static int dance(Control *master, int iteration, Node *acc[],
+                 void (*column_chosen_callback)(const Control *, int, void *),
+                 void (*row_chosen_callback)(const Node *, int, void *),
+                 void (*solution_callback)(Node * [], int, void *),
+                 void *callback_data, DlxCheckpoint *checkpoint) {
+	int level = iteration - checkpoint->start;
+	int skip = 0, ordinal = 0, found;
+	Control *column = NULL;
+	Node *row = NULL;
+	Node *j = NULL;
+	time_t now;
+
+	if(level >= checkpoint->resume) {
+		/* we are past the replayed path, on unsearched ground */
+		checkpoint->resume = 0;
+		if(checkpoint->interval > 0 && ++checkpoint->nodes >= CLOCK_EVERY) {
+			checkpoint->nodes = 0;
+			now = time(NULL);
+			if(now - checkpoint->last_save >= checkpoint->interval) {
+				if(save_dlx_checkpoint(checkpoint, level) < 0) {
+					checkpoint->error = errno;
+					return DLX_CHECKPOINT_UNSAVED;
+				}
+				checkpoint->last_save = now;
+			}
+		}
+	}
+
+	if(master->right == master) {
+		checkpoint->solutions++;
+		if(solution_callback != NULL)
+			solution_callback(acc, iteration, callback_data);
+		return 1;
+	}
+
+	column = choose_column(master);
+	if(level < checkpoint->resume) {
+		if(column->name != checkpoint->names[level]
+		   || checkpoint->ordinals[level] >= column->size)
+			return DLX_CHECKPOINT_MISMATCH;
+		skip = checkpoint->ordinals[level];
+	}
+	if(level >= checkpoint->levels)
+		return DLX_CHECKPOINT_MISMATCH;
+	if(column_chosen_callback != NULL)
+		column_chosen_callback(column, iteration, callback_data);
+	cover_column(column);
+	row = column->node.down;
+	while(row != &(column->node)) {
+		if(ordinal < skip) {
+			row = row->down;
+			ordinal++;
+			continue;
+		}
+		checkpoint->names[level] = column->name;
+		checkpoint->ordinals[level] = ordinal;
+		if(row_chosen_callback != NULL)
+			row_chosen_callback(row, iteration, callback_data);
+		acc[iteration] = row;
+		j = row->right;
+		while(j != row) {
+			cover_column(j->control);
+			j = j->right;
+		}
+
+		found = dance(master, iteration + 1, acc,
+		              column_chosen_callback,
+		              row_chosen_callback,
+		              solution_callback, callback_data, checkpoint);
+#ifndef DLX_EXHAUSTIVE
+		if(found == 1)
+			return 1;
+#endif
+
+		j = row->left;
+		while(j != row) {
+			uncover_column(j->control);
+			j = j->left;
+		}
+		if(found < 0) {
+			uncover_column(column);
+			return found;
+		}
+
+		row = row->down;
+		ordinal++;
+	}
+
+	uncover_column(column);
+	return 0;
+}
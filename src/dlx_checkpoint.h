@@ -0,0 +1,42 @@
+#ifndef DLX_CHECKPOINT_H
+#define DLX_CHECKPOINT_H
+#include <time.h>
+#include "dlx.h"
+
+/* Where a search is, so it can be saved to a file and picked up again by
+ * another process. Node addresses mean nothing to the next process, but a
+ * floor built the same way is searched the same way, so the path down the
+ * search tree is saved as the name of the column chosen at each level and
+ * the position of the current row among that column's remaining rows. */
+typedef struct {
+	const char *path;
+	int interval;              /* seconds between saves, 0 for never */
+	time_t last_save;
+	unsigned long nodes;       /* search nodes since the clock was checked */
+	long tag;                  /* saved along, for the caller's own use */
+	unsigned long long solutions; /* solutions found so far */
+	int start;                 /* iteration the search started at */
+	int levels;                /* room in the arrays below */
+	int *names;                /* column chosen at each level */
+	int *ordinals;             /* row each level is on */
+	int resume;                /* levels of a loaded path still to replay */
+	int (*flush)(void *);      /* called before every save, NULL for none */
+	void *flush_data;
+	int error;                 /* errno of a failed save, 0 if none failed */
+} DlxCheckpoint;
+
+/* What solve_dlx_checkpointed returns when it gives up */
+#define DLX_CHECKPOINT_MISMATCH (-1)
+#define DLX_CHECKPOINT_UNSAVED (-2)
+
+DlxCheckpoint *new_dlx_checkpoint(const char *path, int interval, int levels);
+void free_dlx_checkpoint(DlxCheckpoint *checkpoint);
+int load_dlx_checkpoint(DlxCheckpoint *checkpoint);
+int save_dlx_checkpoint(DlxCheckpoint *checkpoint, int depth);
+int solve_dlx_checkpointed(Control *master, int iteration, Node *acc[],
+                           void (*column_chosen_callback)(const Control *, int, void *),
+                           void (*row_chosen_callback)(const Node *, int, void *),
+                           void (*solution_callback)(Node * [], int, void *),
+                           void *callback_data, DlxCheckpoint *checkpoint);
+
+#endif
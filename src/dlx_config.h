@@ -2,4 +2,12 @@
 #define DLX_CONFIG_H
 
 /*#define DLX_EXHAUSTIVE */
+
+/* Cover forced rows before the search starts branching (see propagate_dlx).
+ * About 15% less time on easy puzzles, no difference on hard ones */
+#define DLX_PROPAGATE
+
+/* Search with dancing cells (dlc.c) instead of dancing links. Links are
+ * faster on our workloads, see tools/bench.c */
+/*#define DLX_CELLS */
 #endif
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include <stdlib.h>
+#include <string.h> /* memcpy, memcmp, memset */
+#include <limits.h>
+
+#include "dlx_memo.h"
+#include "dlx.h"
+
+#define KEY_BITS (sizeof(unsigned long) * CHAR_BIT)
+
+static unsigned long long count_memo(Control *master, DlxMemo *memo, int depth,
+                                     long *zdd, unsigned long *cost);
+static int column_index(const DlxMemo *memo, const Control *column);
+static int compare_columns(const void *a, const void *b);
+static size_t memo_slot(const DlxMemo *memo, const unsigned long *key);
+static void memo_store(DlxMemo *memo, const unsigned long *key,
+                       unsigned long long count, unsigned long cost, long zdd);
+static long zdd_node(DlxMemo *memo, const Node *row, long lo, long hi);
+
+/* Build a cache for the floor under `master`, using at most about
+ * `max_bytes` of memory for the table. The floor must have all its columns
+ * uncovered at this point, and keep the same columns for as long as the
+ * cache is used. Returns NULL if the memory can't be had */
+DlxMemo *new_dlx_memo(Control *master, size_t max_bytes, int policy, FILE *zdd_out) {
+	DlxMemo *memo = calloc(1, sizeof(DlxMemo));
+	Control *column;
+	size_t entry;
+	int i;
+
+	if(memo == NULL)
+		return NULL;
+	memo->columns = 0;
+	for(column = master->right; column != master; column = column->right)
+		memo->columns++;
+	memo->words = (memo->columns + KEY_BITS - 1) / KEY_BITS;
+	if(memo->words == 0)
+		memo->words = 1;
+
+	memo->column = malloc(memo->columns * sizeof(Control *));
+	if(memo->column == NULL) {
+		free_dlx_memo(memo);
+		return NULL;
+	}
+	i = 0;
+	memo->by_name = 1;
+	for(column = master->right; column != master; column = column->right) {
+		if(column->name != i)
+			memo->by_name = 0;
+		memo->column[i++] = column;
+	}
+	if(!memo->by_name)
+		qsort(memo->column, memo->columns, sizeof(Control *), compare_columns);
+	/* every level covers at least one column */
+	memo->scratch = malloc((memo->columns + 1) * memo->words * sizeof(unsigned long));
+
+	entry = memo->words * sizeof(unsigned long) + sizeof(unsigned long long)
+	        + sizeof(unsigned long) + sizeof(long) + 1;
+	memo->slots = max_bytes / entry;
+	if(memo->slots == 0)
+		memo->slots = 1;
+	memo->keys = malloc(memo->slots * memo->words * sizeof(unsigned long));
+	memo->counts = malloc(memo->slots * sizeof(unsigned long long));
+	memo->costs = malloc(memo->slots * sizeof(unsigned long));
+	memo->zdd = malloc(memo->slots * sizeof(long));
+	memo->used = calloc(memo->slots, 1);
+	if(memo->scratch == NULL || memo->keys == NULL || memo->counts == NULL
+	   || memo->costs == NULL || memo->zdd == NULL || memo->used == NULL) {
+		free_dlx_memo(memo);
+		return NULL;
+	}
+
+	memo->policy = policy;
+	memo->zdd_out = zdd_out;
+	memo->zdd_nodes = 2;
+	memo->hits = 0;
+	memo->misses = 0;
+	memo->evictions = 0;
+	return memo;
+}
+
+void free_dlx_memo(DlxMemo *memo) {
+	free(memo->column);
+	free(memo->scratch);
+	free(memo->keys);
+	free(memo->counts);
+	free(memo->costs);
+	free(memo->zdd);
+	free(memo->used);
+	free(memo);
+}
+
+/* Count the solutions of what is left on the floor (saturating at
+ * ULLONG_MAX), reusing the counts of subproblems already seen. The floor is
+ * left as it was found. If `zdd_root` is not NULL it receives the ZDD node
+ * of the whole family of solutions */
+unsigned long long count_dlx(Control *master, DlxMemo *memo, long *zdd_root) {
+	unsigned long cost = 0;
+	long zdd = 0;
+	unsigned long long count;
+	int i;
+
+	/* The key of the starting point is worked out in full, the keys below
+	 * it are derived from their parent's as columns get covered. A column
+	 * is uncovered exactly when its left neighbour still points back at it */
+	memset(memo->scratch, 0, memo->words * sizeof(unsigned long));
+	for(i = 0; i < memo->columns; i++) {
+		if(memo->column[i]->left->right == memo->column[i])
+			memo->scratch[i / KEY_BITS] |= 1UL << (i % KEY_BITS);
+	}
+
+	count = count_memo(master, memo, 0, &zdd, &cost);
+
+	if(zdd_root != NULL)
+		*zdd_root = zdd;
+	return count;
+}
+
+static unsigned long long count_memo(Control *master, DlxMemo *memo, int depth,
+                                     long *zdd, unsigned long *cost) {
+	unsigned long *key = memo->scratch + depth * memo->words;
+	unsigned long *sub_key = key + memo->words;
+	unsigned long long count = 0, sub;
+	unsigned long sub_cost = 0;
+	Control *column = NULL;
+	Node *row = NULL, *j = NULL;
+	long sub_zdd, lo = 0;
+	size_t slot;
+	int i;
+
+	*cost += 1;
+	if(master->right == master) {
+		*zdd = 1;
+		return 1;
+	}
+
+	slot = memo_slot(memo, key);
+	if(memo->used[slot]
+	   && memcmp(memo->keys + slot * memo->words, key,
+	             memo->words * sizeof(unsigned long)) == 0) {
+		memo->hits++;
+		*zdd = memo->zdd[slot];
+		return memo->counts[slot];
+	}
+	memo->misses++;
+
+	column = choose_column(master);
+	cover_column(column);
+	/* Bottom up, so the ZDD chain comes out in floor order */
+	row = column->node.up;
+	while(row != &(column->node)) {
+		memcpy(sub_key, key, memo->words * sizeof(unsigned long));
+		i = column_index(memo, column);
+		sub_key[i / KEY_BITS] &= ~(1UL << (i % KEY_BITS));
+		j = row->right;
+		while(j != row) {
+			cover_column(j->control);
+			i = column_index(memo, j->control);
+			sub_key[i / KEY_BITS] &= ~(1UL << (i % KEY_BITS));
+			j = j->right;
+		}
+
+		sub = count_memo(master, memo, depth + 1, &sub_zdd, &sub_cost);
+		count = (count > ULLONG_MAX - sub) ? ULLONG_MAX : count + sub;
+		if(sub > 0 && memo->zdd_out != NULL)
+			lo = zdd_node(memo, row, lo, sub_zdd);
+
+		j = row->left;
+		while(j != row) {
+			uncover_column(j->control);
+			j = j->left;
+		}
+		row = row->up;
+	}
+	uncover_column(column);
+
+	*zdd = lo;
+	*cost += sub_cost;
+	memo_store(memo, key, count, sub_cost, lo);
+	return count;
+}
+
+/* Bit of `column` in the keys. Floors whose columns are named 0, 1, 2...
+ * in order (sudoku's are) use the name, any other floor has its columns
+ * sorted by address and looks them up */
+static int column_index(const DlxMemo *memo, const Control *column) {
+	Control **found;
+
+	if(memo->by_name)
+		return column->name;
+	found = bsearch(&column, memo->column, memo->columns, sizeof(Control *),
+	                compare_columns);
+	return (int) (found - memo->column);
+}
+
+static int compare_columns(const void *a, const void *b) {
+	const Control *x = *(Control * const *) a;
+	const Control *y = *(Control * const *) b;
+
+	return (x > y) - (x < y);
+}
+
+static size_t memo_slot(const DlxMemo *memo, const unsigned long *key) {
+	unsigned long long hash = 14695981039346656037ULL;
+	int i;
+
+	for(i = 0; i < memo->words; i++) {
+		hash ^= key[i];
+		hash *= 1099511628211ULL;
+		hash ^= hash >> 29;
+	}
+	return (size_t) (hash % memo->slots);
+}
+
+static void memo_store(DlxMemo *memo, const unsigned long *key,
+                       unsigned long long count, unsigned long cost, long zdd) {
+	size_t slot = memo_slot(memo, key);
+
+	if(memo->used[slot]) {
+		if(memo->policy == MEMO_KEEP)
+			return;
+		if(memo->policy == MEMO_COSTLIER && memo->costs[slot] > cost)
+			return;
+		memo->evictions++;
+	}
+
+	memcpy(memo->keys + slot * memo->words, key, memo->words * sizeof(unsigned long));
+	memo->counts[slot] = count;
+	memo->costs[slot] = cost;
+	memo->zdd[slot] = zdd;
+	memo->used[slot] = 1;
+}
+
+static long zdd_node(DlxMemo *memo, const Node *row, long lo, long hi) {
+	const Node *j = row;
+	long id = memo->zdd_nodes++;
+
+	fprintf(memo->zdd_out, "%ld: [", id);
+	do {
+		fprintf(memo->zdd_out, j == row ? "%d" : " %d", j->control->name);
+		j = j->right;
+	} while(j != row);
+	fprintf(memo->zdd_out, "] %ld %ld\n", lo, hi);
+	return id;
+}
@@ -0,0 +1,45 @@
+#ifndef DLX_MEMO_H
+#define DLX_MEMO_H
+#include <stdio.h>
+#include <stddef.h>
+#include "dlx.h"
+
+/* What happens when a new subproblem hashes to an occupied slot */
+#define MEMO_REPLACE 0  /* the new entry always takes the slot */
+#define MEMO_KEEP 1     /* the slot keeps the entry it has */
+#define MEMO_COSTLIER 2 /* the slot keeps whichever took more search to compute */
+
+/* Cache of solution counts for residual exact cover problems. On a given
+ * floor the rows still available are exactly those whose columns are all
+ * uncovered, so the set of uncovered columns identifies the subproblem; it
+ * is the key, as a bitset over the columns. The table has a
+ * fixed number of slots and never grows.
+ *
+ * If `zdd_out` is set, counting also writes every distinct subproblem as a
+ * node of a ZDD-style DAG of all solutions, one per line:
+ *     id: [names of the row's columns] lo hi
+ * meaning "solutions that use the row, continuing as hi, or else lo". 0 is
+ * the empty family and 1 the family holding only the empty solution. */
+typedef struct {
+	int columns;
+	int words;                 /* unsigned longs per key */
+	Control **column;          /* the columns, by key bit */
+	int by_name;               /* whether column i is the one named i */
+	unsigned long *scratch;    /* one key per recursion level */
+	size_t slots;
+	unsigned long *keys;
+	unsigned long long *counts;
+	unsigned long *costs;      /* search nodes spent computing each entry */
+	long *zdd;                 /* ZDD node of each entry */
+	char *used;
+	int policy;
+	FILE *zdd_out;
+	long zdd_nodes;            /* ids handed out so far */
+	unsigned long long hits, misses, evictions;
+} DlxMemo;
+
+DlxMemo *new_dlx_memo(Control *master, size_t max_bytes, int policy, FILE *zdd_out);
+void free_dlx_memo(DlxMemo *memo);
+unsigned long long count_dlx(Control *master, DlxMemo *memo, long *zdd_root);
+
+#endif
@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <string.h> /* memset */
+
+#include "killer.h"
+#include "sudoku.h"
+#include "dlx_config.h"
+#include "dlx.h"
+
+static int dance_killer(Killer *killer, Control *master, int iteration, Node *acc[]);
+static int fits(const Killer *killer, int pos, int n);
+static void place(Killer *killer, int pos, int n);
+static void unplace(Killer *killer, int pos, int n);
+static int on_floor(const Node *row);
+static void narrow_cage(Killer *killer, int pos);
+static int cage_allows(const Killer *killer, const Cage *cage, unsigned short digits);
+static void row_cell(const Node *row, int *pos, int *n);
+
+void build_killer_tables(KillerTables *tables) {
+	int set, size, sum, n, k;
+	short next[10][46];
+
+	memset(tables->count, 0, sizeof(tables->count));
+	for(set = 0; set < 512; set++) {
+		size = 0;
+		sum = 0;
+		for(n = 1; n <= 9; n++) {
+			if(set & (1 << (n - 1))) {
+				size++;
+				sum += n;
+			}
+		}
+		tables->count[size][sum]++;
+	}
+
+	k = 0;
+	for(size = 0; size <= 9; size++) {
+		for(sum = 0; sum <= 45; sum++) {
+			tables->first[size][sum] = k;
+			next[size][sum] = k;
+			k += tables->count[size][sum];
+		}
+	}
+
+	for(set = 0; set < 512; set++) {
+		size = 0;
+		sum = 0;
+		for(n = 1; n <= 9; n++) {
+			if(set & (1 << (n - 1))) {
+				size++;
+				sum += n;
+			}
+		}
+		tables->sets[next[size][sum]++] = set;
+	}
+}
+
+/* Read cages written as `sum:cell,cell,...` separated by ';', cells being
+ * numbered 0 to 80 left to right, top to bottom; for instance
+ * "3:0,1;15:2,11,20". Cells in no cage are allowed. Returns 0, or -1 if the
+ * cages make no sense (a cell twice, a sum no set of digits adds up to...) */
+int parse_killer(Killer *killer, const KillerTables *tables, const char *cages) {
+	const char *c = cages;
+	char *end;
+	Cage *cage;
+	long value;
+	int i, k;
+
+	killer->tables = tables;
+	killer->cages = 0;
+	for(i = 0; i < 81; i++)
+		killer->cage_of[i] = -1;
+
+	while(*c != '\0') {
+		if(killer->cages == 81)
+			return -1;
+		cage = killer->cage + killer->cages;
+		value = strtol(c, &end, 10);
+		if(end == c || *end != ':' || value < 1 || value > 45)
+			return -1;
+		cage->sum = value;
+		cage->size = 0;
+		c = end;
+		do {
+			c++;
+			value = strtol(c, &end, 10);
+			if(end == c || value < 0 || value > 80 || cage->size == 9
+			   || killer->cage_of[value] != -1)
+				return -1;
+			killer->cage_of[value] = killer->cages;
+			cage->cells[cage->size++] = value;
+			c = end;
+		} while(*c == ',');
+		if(*c == ';')
+			c++;
+		else if(*c != '\0')
+			return -1;
+
+		cage->allowed = 0;
+		for(k = 0; k < tables->count[cage->size][cage->sum]; k++)
+			cage->allowed |= tables->sets[tables->first[cage->size][cage->sum] + k];
+		if(cage->allowed == 0)
+			return -1;
+		killer->cages++;
+	}
+	return 0;
+}
+
+/* Solve a killer sudoku: `givens` as for fill_sudoku (usually empty), cages
+ * from parse_killer. Rows putting a digit in a cage that none of its digit
+ * sets has are hidden before the dance, and during it, every time a cage
+ * gets a digit, so are the rows that no longer leave it a set it can
+ * complete. The first solution found is
+ * written to `solution` (82 characters). Returns the number of solutions
+ * found (at most 1 unless built with DLX_EXHAUSTIVE). The floor is left as
+ * it was found */
+int solve_killer(Sudoku *sudoku, Killer *killer, const char *givens, char *solution) {
+	Node *row;
+	int i, pos, n;
+
+	if(!valid_sudoku(givens))
+		return 0;
+
+	for(i = 0; i < killer->cages; i++)
+		killer->cage[i].used = 0;
+	for(i = 0; i < 81; i++) {
+		if(givens[i] > '0' && givens[i] <= '9') {
+			if(!fits(killer, i, givens[i] - '0'))
+				return 0;
+			place(killer, i, givens[i] - '0');
+		}
+	}
+
+	fill_sudoku(sudoku, (char *) givens);
+	killer->nodes = sudoku->nodes;
+	killer->hidden = 0;
+	for(i = 0; i < 729; i++) {
+		row = sudoku->nodes + 4*i;
+		if(!on_floor(row))
+			continue;
+		row_cell(row, &pos, &n);
+		if(killer->cage_of[pos] != -1
+		   && !(killer->cage[killer->cage_of[pos]].allowed & (1 << (n - 1)))) {
+			hide_row(row);
+			killer->hidden_rows[killer->hidden++] = row;
+		}
+	}
+
+	killer->solution = solution;
+	killer->found = 0;
+	dance_killer(killer, sudoku->master, sudoku->iteration, sudoku->solutions);
+
+	for(i = killer->hidden - 1; i >= 0; i--)
+		unhide_row(killer->hidden_rows[i]);
+	unfill_sudoku(sudoku);
+	return killer->found;
+}
+
+/* solve_dlx, refusing rows the cages don't allow and hiding the ones they
+ * stop allowing. Always puts everything back on the way out */
+static int dance_killer(Killer *killer, Control *master, int iteration, Node *acc[]) {
+	Control *column = NULL;
+	Node *row = NULL;
+	Node *j = NULL;
+	int pos, n, hidden, done = 0;
+
+	if(master->right == master) {
+		if(killer->found == 0)
+			write_solution_sudoku(acc, killer->solution);
+		killer->found++;
+		return 1;
+	}
+
+	column = choose_column(master);
+	cover_column(column);
+	row = column->node.down;
+	while(row != &(column->node) && !done) {
+		row_cell(row, &pos, &n);
+		if(fits(killer, pos, n)) {
+			place(killer, pos, n);
+			acc[iteration] = row;
+			j = row->right;
+			while(j != row) {
+				cover_column(j->control);
+				j = j->right;
+			}
+			hidden = killer->hidden;
+			narrow_cage(killer, pos);
+
+			done = dance_killer(killer, master, iteration + 1, acc);
+#ifdef DLX_EXHAUSTIVE
+			done = 0;
+#endif
+
+			while(killer->hidden > hidden)
+				unhide_row(killer->hidden_rows[--killer->hidden]);
+			j = row->left;
+			while(j != row) {
+				uncover_column(j->control);
+				j = j->left;
+			}
+			unplace(killer, pos, n);
+		}
+		row = row->down;
+	}
+
+	uncover_column(column);
+	return done;
+}
+
+/* Whether n can go in the cage of cell `pos`: not already in it, and the
+ * cage left with a set of digits it can still be completed to */
+static int fits(const Killer *killer, int pos, int n) {
+	const Cage *cage;
+
+	if(killer->cage_of[pos] == -1)
+		return 1;
+	cage = killer->cage + killer->cage_of[pos];
+	if(cage->used & (1 << (n - 1)))
+		return 0;
+	return cage_allows(killer, cage, cage->used | (1 << (n - 1)));
+}
+
+static void place(Killer *killer, int pos, int n) {
+	if(killer->cage_of[pos] != -1)
+		killer->cage[killer->cage_of[pos]].used |= 1 << (n - 1);
+}
+
+static void unplace(Killer *killer, int pos, int n) {
+	if(killer->cage_of[pos] != -1)
+		killer->cage[killer->cage_of[pos]].used &= ~(1 << (n - 1));
+}
+
+/* Once a digit goes in a cage, hide the rows of its other cells that
+ * no longer fit, so that choose_column sees how few options are left */
+static void narrow_cage(Killer *killer, int pos) {
+	const Cage *cage;
+	Node *row;
+	int k, cell, n;
+
+	if(killer->cage_of[pos] == -1)
+		return;
+	cage = killer->cage + killer->cage_of[pos];
+	for(k = 0; k < cage->size; k++) {
+		cell = cage->cells[k];
+		for(n = 1; n <= 9; n++) {
+			row = killer->nodes + node_for(cell/9, cell%9, n);
+			if(on_floor(row) && !fits(killer, cell, n)) {
+				hide_row(row);
+				killer->hidden_rows[killer->hidden++] = row;
+			}
+		}
+	}
+}
+
+/* A row is on the floor as long as it isn't hidden and none of its columns
+ * is covered; a column is uncovered exactly when its left neighbour points
+ * back at it, and a row with all its columns uncovered is only unlinked
+ * from them if hidden */
+static int on_floor(const Node *row) {
+	const Node *j = row;
+
+	if(row->up->down != row)
+		return 0;
+	do {
+		if(j->control->left->right != j->control)
+			return 0;
+		j = j->right;
+	} while(j != row);
+	return 1;
+}
+
+/* Whether some set of digits the cage can hold contains `digits` */
+static int cage_allows(const Killer *killer, const Cage *cage, unsigned short digits) {
+	const KillerTables *tables = killer->tables;
+	int k, first = tables->first[cage->size][cage->sum];
+
+	for(k = 0; k < tables->count[cage->size][cage->sum]; k++) {
+		if((tables->sets[first + k] & digits) == digits)
+			return 1;
+	}
+	return 0;
+}
+
+/* Which cell a row fills, and with what */
+static void row_cell(const Node *row, int *pos, int *n) {
+	const Node *current = row;
+
+	while(current->control->name >= 81) {
+		current = current->right;
+	}
+	*pos = current->control->name;
+	*n = (current->right->control->name % 9) + 1;
+}
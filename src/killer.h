@@ -0,0 +1,40 @@
+#ifndef KILLER_H
+#define KILLER_H
+#include "sudoku.h"
+
+/* Every set of distinct digits, grouped by how many digits it has and what
+ * they add up to: the sets a cage of `size` cells summing to `sum` can hold
+ * are sets[first[size][sum]] onwards, count[size][sum] of them. Built once
+ * and only read afterwards, so one copy can serve any number of puzzles and
+ * threads. Bit n-1 stands for the digit n */
+typedef struct {
+	unsigned short sets[512];
+	short first[10][46];
+	short count[10][46];
+} KillerTables;
+
+typedef struct {
+	int sum;
+	int size;
+	int cells[9];
+	unsigned short allowed; /* digits in at least one of the cage's sets */
+	unsigned short used;    /* digits placed in the cage so far */
+} Cage;
+
+typedef struct {
+	const KillerTables *tables;
+	int cages;
+	Cage cage[81];
+	int cage_of[81];        /* -1 for cells in no cage */
+	Node *nodes;            /* of the floor being solved */
+	int hidden;
+	Node *hidden_rows[729]; /* rows taken off the floor, in order */
+	char *solution;
+	int found;
+} Killer;
+
+void build_killer_tables(KillerTables *tables);
+int parse_killer(Killer *killer, const KillerTables *tables, const char *cages);
+int solve_killer(Sudoku *sudoku, Killer *killer, const char *givens, char *solution);
+
+#endif
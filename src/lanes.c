@@ -0,0 +1,145 @@
+#include <string.h> /* memset */
+
+#include "lanes.h"
+
+#define ALL_DIGITS 0x1FF
+
+static void unit_cells(int unit, int cells[9]);
+
+void clear_lanes(LaneBatch *batch) {
+	memset(batch, 0, sizeof(LaneBatch));
+}
+
+/* Put `puzzle` (digits 1 to 9 are clues, anything else is empty) in the next
+ * free lane. A NULL puzzle takes a lane that is dead from the start, so that
+ * input which isn't a puzzle keeps its place in the batch. Returns the lane
+ * used, or -1 if the batch is full */
+int load_lane(LaneBatch *batch, const char *puzzle) {
+	int lane = batch->count;
+	int i;
+
+	if(lane >= LANES)
+		return -1;
+	if(puzzle == NULL) {
+		for(i = 0; i < 81; i++)
+			batch->candidates[i][lane] = 0;
+		batch->dead[lane] = 1;
+		batch->count++;
+		return lane;
+	}
+	for(i = 0; i < 81; i++) {
+		if(puzzle[i] > '0' && puzzle[i] <= '9')
+			batch->candidates[i][lane] = 1 << (puzzle[i] - '1');
+		else
+			batch->candidates[i][lane] = ALL_DIGITS;
+	}
+	batch->dead[lane] = 0;
+	batch->count++;
+	return lane;
+}
+
+/* Remove candidates from every lane at once until nothing changes. Two rules
+ * are applied unit by unit: a digit fixed in one cell is removed from the
+ * rest of the unit (naked singles), and a digit that can only go in one cell
+ * of the unit is placed there (hidden singles). Every step is a branch free
+ * loop over the lanes, which the compiler turns into vector instructions.
+ * Unused lanes have no candidates at all and are dead from the first pass */
+void propagate_lanes(LaneBatch *batch) {
+	uint16_t once[LANES], twice[LANES], fixed[LANES], clash[LANES];
+	uint16_t changed[LANES];
+	uint16_t x, y, single;
+	int cells[9];
+	int unit, k, l, any;
+
+	do {
+		memset(changed, 0, sizeof(changed));
+		for(unit = 0; unit < 27; unit++) {
+			unit_cells(unit, cells);
+			memset(once, 0, sizeof(once));
+			memset(twice, 0, sizeof(twice));
+			memset(fixed, 0, sizeof(fixed));
+			memset(clash, 0, sizeof(clash));
+
+			/* What digits does the unit hold, and how many times */
+			for(k = 0; k < 9; k++) {
+				for(l = 0; l < LANES; l++) {
+					x = batch->candidates[cells[k]][l];
+					single = -(uint16_t) ((x & (x - 1)) == 0);
+					twice[l] |= once[l] & x;
+					once[l] |= x;
+					clash[l] |= fixed[l] & x & single;
+					fixed[l] |= x & single;
+				}
+			}
+
+			for(k = 0; k < 9; k++) {
+				for(l = 0; l < LANES; l++) {
+					x = batch->candidates[cells[k]][l];
+					single = -(uint16_t) ((x & (x - 1)) == 0);
+					/* naked singles */
+					y = x & ~(fixed[l] & ~single);
+					/* hidden singles */
+					y = (y & once[l] & ~twice[l] & ~single)
+					    ? (y & once[l] & ~twice[l]) : y;
+					changed[l] |= x ^ y;
+					batch->candidates[cells[k]][l] = y;
+				}
+			}
+
+			for(l = 0; l < LANES; l++)
+				batch->dead[l] |= clash[l] | (~once[l] & ALL_DIGITS);
+		}
+
+		any = 0;
+		for(l = 0; l < LANES; l++)
+			any |= changed[l] & ~batch->dead[l];
+	} while(any);
+}
+
+int lane_status(const LaneBatch *batch, int lane) {
+	uint16_t x;
+	int i;
+
+	if(batch->dead[lane])
+		return LANE_CONTRADICTION;
+	for(i = 0; i < 81; i++) {
+		x = batch->candidates[i][lane];
+		if(x & (x - 1))
+			return LANE_STUCK;
+	}
+	return LANE_SOLVED;
+}
+
+/* Write the lane as an 81 character board: cells with a single candidate
+ * get their digit, the others '0'. `board` needs room for 82 characters */
+void lane_board(const LaneBatch *batch, int lane, char *board) {
+	uint16_t x;
+	int i, n;
+
+	for(i = 0; i < 81; i++) {
+		x = batch->candidates[i][lane];
+		board[i] = '0';
+		if(x != 0 && (x & (x - 1)) == 0) {
+			for(n = 1; x >>= 1; n++)
+				;
+			board[i] = '0' + n;
+		}
+	}
+	board[81] = '\0';
+}
+
+/* Units 0-8 are rows, 9-17 columns and 18-26 the 3x3 squares */
+static void unit_cells(int unit, int cells[9]) {
+	int k, square;
+
+	for(k = 0; k < 9; k++) {
+		if(unit < 9)
+			cells[k] = unit*9 + k;
+		else if(unit < 18)
+			cells[k] = k*9 + (unit - 9);
+		else {
+			square = unit - 18;
+			cells[k] = (3*(square/3) + k/3)*9 + 3*(square%3) + k%3;
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef LANES_H
+#define LANES_H
+#include <stdint.h>
+
+/* Number of puzzles propagated side by side. 16 lanes of 16 bit candidate
+ * sets fill one 256 bit vector register */
+#define LANES 16
+
+#define LANE_SOLVED 1
+#define LANE_STUCK 0
+#define LANE_CONTRADICTION (-1)
+
+/* Candidate sets are stored cell by cell, and for every cell lane by lane
+ * (structure of arrays), so that the same operation on the same cell of
+ * every puzzle in the batch is a single pass over contiguous memory. Bit
+ * n-1 is set when n is still possible in that cell. */
+typedef struct {
+	uint16_t candidates[81][LANES];
+	uint16_t dead[LANES]; /* non zero once a lane contradicts itself */
+	int count;
+} LaneBatch;
+
+void clear_lanes(LaneBatch *batch);
+int load_lane(LaneBatch *batch, const char *puzzle);
+void propagate_lanes(LaneBatch *batch);
+int lane_status(const LaneBatch *batch, int lane);
+void lane_board(const LaneBatch *batch, int lane, char *board);
+
+#endif
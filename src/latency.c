@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h> /* memset, memcpy */
+#include <time.h>
+
+#include "latency.h"
+
+#define SUB (1ULL << LATENCY_SUB_BITS)
+#define HALF (SUB / 2)
+
+static int bucket_of(unsigned long long value);
+static unsigned long long bucket_top(int bucket);
+
+unsigned long long monotonic_nanoseconds(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void clear_latency(LatencyHistogram *histogram) {
+	memset(histogram, 0, sizeof(LatencyHistogram));
+}
+
+void record_latency(LatencyHistogram *histogram, unsigned long long nanoseconds) {
+	histogram->counts[bucket_of(nanoseconds)]++;
+	histogram->total++;
+	if(nanoseconds > histogram->max)
+		histogram->max = nanoseconds;
+}
+
+/* The latency `percentile` percent of the recordings are at or under, as
+ * the top of its bucket (never above the largest recorded) */
+unsigned long long latency_percentile(const LatencyHistogram *histogram, double percentile) {
+	unsigned long long wanted, seen = 0, top;
+	int bucket;
+
+	if(histogram->total == 0)
+		return 0;
+	wanted = (unsigned long long) (percentile / 100.0 * histogram->total + 0.999999);
+	if(wanted == 0)
+		wanted = 1;
+	for(bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+		seen += histogram->counts[bucket];
+		if(seen >= wanted) {
+			top = bucket_top(bucket);
+			return top < histogram->max ? top : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+/* Below SUB values are their own bucket. Above, a value with its highest
+ * bit at position `top` keeps its LATENCY_SUB_BITS highest bits, the
+ * leading one included */
+static int bucket_of(unsigned long long value) {
+	int top = 0, shift;
+
+	if(value < SUB)
+		return (int) value;
+	while((value >> top) > 1)
+		top++;
+	shift = top - LATENCY_SUB_BITS + 1;
+	return (int) (SUB + (shift - 1) * HALF + ((value >> shift) - HALF));
+}
+
+static unsigned long long bucket_top(int bucket) {
+	unsigned long long mantissa;
+	int shift;
+
+	if(bucket < (int) SUB)
+		return bucket;
+	shift = (bucket - SUB) / HALF + 1;
+	mantissa = (bucket - SUB) % HALF + HALF;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+SlowList *new_slow_list(int size) {
+	SlowList *list = malloc(sizeof(SlowList));
+
+	list->size = size;
+	list->count = 0;
+	list->puzzles = malloc((size > 0 ? size : 1) * sizeof(struct slow_puzzle));
+	return list;
+}
+
+void free_slow_list(SlowList *list) {
+	free(list->puzzles);
+	free(list);
+}
+
+/* Keep the puzzle if it is among the `size` slowest so far */
+void record_slow_puzzle(SlowList *list, unsigned long long nanoseconds,
+                        long nodes, const char *puzzle) {
+	int k = list->count;
+
+	if(list->size == 0
+	   || (k == list->size && list->puzzles[k - 1].nanoseconds >= nanoseconds))
+		return;
+	if(k == list->size)
+		k--;
+	else
+		list->count++;
+	/* insertion into the sorted list; it is expected to be short */
+	while(k > 0 && list->puzzles[k - 1].nanoseconds < nanoseconds) {
+		list->puzzles[k] = list->puzzles[k - 1];
+		k--;
+	}
+	list->puzzles[k].nanoseconds = nanoseconds;
+	list->puzzles[k].nodes = nodes;
+	memcpy(list->puzzles[k].puzzle, puzzle, 81);
+	list->puzzles[k].puzzle[81] = '\0';
+}
+
+/* A histogram and a list of the `slowest` slowest puzzles */
+Timing *new_timing(int slowest) {
+	Timing *timing = malloc(sizeof(Timing));
+
+	clear_latency(&timing->histogram);
+	timing->slowest = new_slow_list(slowest);
+	return timing;
+}
+
+void free_timing(Timing *timing) {
+	free_slow_list(timing->slowest);
+	free(timing);
+}
+
+void record_timing(Timing *timing, unsigned long long nanoseconds,
+                   long nodes, const char *puzzle) {
+	record_latency(&timing->histogram, nanoseconds);
+	record_slow_puzzle(timing->slowest, nanoseconds, nodes, puzzle);
+}
+
+/* Add what `from` recorded to `into`, as if it had all been recorded there */
+void merge_timing(Timing *into, const Timing *from) {
+	int bucket, k;
+
+	for(bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+		into->histogram.counts[bucket] += from->histogram.counts[bucket];
+	into->histogram.total += from->histogram.total;
+	if(from->histogram.max > into->histogram.max)
+		into->histogram.max = from->histogram.max;
+	for(k = 0; k < from->slowest->count; k++)
+		record_slow_puzzle(into->slowest, from->slowest->puzzles[k].nanoseconds,
+		                   from->slowest->puzzles[k].nodes,
+		                   from->slowest->puzzles[k].puzzle);
+}
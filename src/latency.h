@@ -0,0 +1,50 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+/* Values below 2^LATENCY_SUB_BITS are counted exactly, larger ones in
+ * buckets of 2^(LATENCY_SUB_BITS - 1) per power of two, i.e. to within
+ * about 3% */
+#define LATENCY_SUB_BITS 6
+#define LATENCY_BUCKETS 2048
+
+/* HDR style histogram of latencies in nanoseconds */
+typedef struct {
+	unsigned long long counts[LATENCY_BUCKETS];
+	unsigned long long total;
+	unsigned long long max;
+} LatencyHistogram;
+
+/* The slowest puzzles seen so far, slowest first */
+struct slow_puzzle {
+	unsigned long long nanoseconds;
+	long nodes; /* search nodes, -1 if not known */
+	char puzzle[82];
+};
+
+typedef struct {
+	int size;
+	int count;
+	struct slow_puzzle *puzzles;
+} SlowList;
+
+/* Everything kept when timing puzzles */
+typedef struct {
+	LatencyHistogram histogram;
+	SlowList *slowest;
+} Timing;
+
+unsigned long long monotonic_nanoseconds(void);
+void clear_latency(LatencyHistogram *histogram);
+void record_latency(LatencyHistogram *histogram, unsigned long long nanoseconds);
+unsigned long long latency_percentile(const LatencyHistogram *histogram, double percentile);
+SlowList *new_slow_list(int size);
+void free_slow_list(SlowList *list);
+void record_slow_puzzle(SlowList *list, unsigned long long nanoseconds,
+                        long nodes, const char *puzzle);
+Timing *new_timing(int slowest);
+void free_timing(Timing *timing);
+void record_timing(Timing *timing, unsigned long long nanoseconds,
+                   long nodes, const char *puzzle);
+void merge_timing(Timing *into, const Timing *from);
+
+#endif
@@ -1,33 +1,609 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
 #include "dlx_config.h"
 #include "dlx.h"
 #include "sudoku.h"
 #include "sudoku_solutions.h"
+#include "sudoku_beast.h"
+#include "lanes.h"
+#include "dlx_memo.h"
+#include "dlx_checkpoint.h"
+#include "portfolio.h"
+#include "corpus.h"
+#include "killer.h"
+#include "pool.h"
+#include "latency.h"
 
-int main()
+/* Where puzzles come from: stdin, or a packed corpus read in order */
+typedef struct {
+	const Corpus *corpus;      /* NULL for stdin */
+	size_t next;               /* next corpus record to read */
+} PuzzleSource;
+
+static int read_puzzle(PuzzleSource *source, char *input);
+static void solve_json(PuzzleSource *source, Timing *timing);
+static void solve_batches(PuzzleSource *source, Timing *timing);
+static void finish_batch(LaneBatch *batch, char inputs[][82], sudoku_beast *beast,
+                         Timing *timing);
+static int count_solutions(PuzzleSource *source, size_t memo_bytes, int policy,
+                           FILE *zdd_out);
+static int enumerate_solutions(PuzzleSource *source, const char *path, int interval);
+static void solve_raced(PuzzleSource *source, int workers, Timing *timing);
+static void solve_killers(void);
+static void solve_pooled(PuzzleSource *source, const PoolOptions *options,
+                         Timing *timing);
+static int flush_stream(void *stream);
+static void print_numbered_solution(Node *acc[], int iteration, void *index);
+static void report_latency(const Timing *timing);
+static int parse_count(const char *text, int least, int *value);
+static void usage(const char *name);
+
+/* Usage: sudoku-beast [-b corpus_file] [-t] [-T slowest]
+ *                     [-s | -p workers | -w workers [-H] | -x
+ *                     | -c [-M megabytes] [-E replace|keep|costlier]
+ *                     [-z zdd_file] | -k checkpoint_file [-K seconds]]
+ * Only one of -s, -p, -w, -x, -c and -k can be given.
+ * Reads puzzles from stdin, one per line, or from a packed corpus with -b
+ * (see corpus.h). By default every solution is printed in JSON with the
+ * steps to reach it; with -s only the solutions are printed, one per line,
+ * which lets easy puzzles be solved many at a time.
+ * -p prints the same, racing that many differently tuned searches on each
+ * puzzle (see portfolio.h), and so does -w, solving that many puzzles at a
+ * time on threads pinned to CPUs (0 for one per CPU, see pool.h), with -H
+ * asking for huge pages. In all of these modes -t times every puzzle and
+ * ends with a latency histogram on stderr, -T also lists the slowest
+ * puzzles there. -x reads killer sudokus from stdin instead, as
+ * the clues followed by the cages (see parse_killer), and prints the same;
+ * it can't be used with -b. Neither it nor -c or -k can be timed.
+ * With -c the solutions of each puzzle are counted instead, caching the
+ * counts of subproblems in -M megabytes (64 by default), evicted following
+ * -E (costlier by default). -z writes the DAG of all solutions to a file.
+ * With -k every solution is printed after the number of its puzzle (all of
+ * them when built with DLX_EXHAUSTIVE), saving where the search is to the
+ * checkpoint file every -K seconds (60 by default, 0 for never); running
+ * again with the same file and input picks up from the last save */
+int main(int argc, char *argv[])
+{
+	int solutions_only = 0, counting = 0, killers = 0, counting_options = 0;
+	size_t memo_bytes = (size_t) 64 << 20;
+	long megabytes;
+	char *end;
+	int policy = MEMO_COSTLIER;
+	FILE *zdd_out = NULL;
+	const char *checkpoint_path = NULL;
+	int interval = 60, interval_given = 0;
+	int workers = 0;
+	PoolOptions pool_options = { -1, 0 };
+	int timed = 0, slow_count = 0;
+	Timing *timing = NULL;
+	Corpus packed;
+	PuzzleSource source = { NULL, 0 };
+	int i, modes;
+
+	for(i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-s") == 0)
+			solutions_only = 1;
+		else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			if(open_corpus(&packed, argv[++i]) < 0) {
+				fprintf(stderr, "%s: not a readable corpus\n", argv[i]);
+				return 1;
+			}
+			source.corpus = &packed;
+		}
+		else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			if(!parse_count(argv[++i], 1, &workers)) {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "-t") == 0)
+			timed = 1;
+		else if(strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+			timed = 1;
+			if(!parse_count(argv[++i], 1, &slow_count)) {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			if(!parse_count(argv[++i], 0, &pool_options.workers)) {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "-H") == 0)
+			pool_options.huge_pages = 1;
+		else if(strcmp(argv[i], "-x") == 0)
+			killers = 1;
+		else if(strcmp(argv[i], "-c") == 0)
+			counting = 1;
+		else if(strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+			counting_options = 1;
+			megabytes = strtol(argv[++i], &end, 10);
+			if(*end != '\0' || megabytes <= 0
+			   || (unsigned long) megabytes > SIZE_MAX >> 20) {
+				usage(argv[0]);
+				return 1;
+			}
+			memo_bytes = (size_t) megabytes << 20;
+		}
+		else if(strcmp(argv[i], "-E") == 0 && i + 1 < argc) {
+			counting_options = 1;
+			i++;
+			if(strcmp(argv[i], "replace") == 0)
+				policy = MEMO_REPLACE;
+			else if(strcmp(argv[i], "keep") == 0)
+				policy = MEMO_KEEP;
+			else if(strcmp(argv[i], "costlier") == 0)
+				policy = MEMO_COSTLIER;
+			else {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+			checkpoint_path = argv[++i];
+		else if(strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+			interval_given = 1;
+			if(!parse_count(argv[++i], 0, &interval)) {
+				usage(argv[0]);
+				return 1;
+			}
+		}
+		else if(strcmp(argv[i], "-z") == 0 && i + 1 < argc) {
+			counting_options = 1;
+			zdd_out = fopen(argv[++i], "w");
+			if(zdd_out == NULL) {
+				perror(argv[i]);
+				return 1;
+			}
+		}
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	/* one mode at most, options only with their mode; corpus records have
+	 * no room for cages, and only puzzle at a time solving is timed */
+	modes = solutions_only + counting + killers + (checkpoint_path != NULL)
+	        + (workers > 0) + (pool_options.workers >= 0);
+	if(modes > 1
+	   || (pool_options.huge_pages && pool_options.workers < 0)
+	   || (interval_given && checkpoint_path == NULL)
+	   || (counting_options && !counting)
+	   || (killers && source.corpus != NULL)
+	   || (timed && (killers || counting || checkpoint_path != NULL))) {
+		usage(argv[0]);
+		if(source.corpus != NULL)
+			close_corpus(&packed);
+		return 1;
+	}
+
+	if(timed)
+		timing = new_timing(slow_count);
+
+	if(checkpoint_path != NULL) {
+		if(enumerate_solutions(&source, checkpoint_path, interval) < 0)
+			return 1;
+	}
+	else if(counting) {
+		if(count_solutions(&source, memo_bytes, policy, zdd_out) < 0)
+			return 1;
+	}
+	else if(killers)
+		solve_killers();
+	else if(workers > 0)
+		solve_raced(&source, workers, timing);
+	else if(pool_options.workers >= 0)
+		solve_pooled(&source, &pool_options, timing);
+	else if(solutions_only)
+		solve_batches(&source, timing);
+	else
+		solve_json(&source, timing);
+
+	if(timing != NULL) {
+		report_latency(timing);
+		free_timing(timing);
+	}
+	if(zdd_out != NULL)
+		fclose(zdd_out);
+	if(source.corpus != NULL)
+		close_corpus(&packed);
+	
+	return (0);
+}
+
+/* Read `text` as a whole number, at least `least`, into `value`. Returns 0
+ * if it is anything else */
+static int parse_count(const char *text, int least, int *value)
+{
+	char *end;
+	long number;
+
+	errno = 0;
+	number = strtol(text, &end, 10);
+	if(end == text || *end != '\0' || errno != 0
+	   || number < least || number > INT_MAX)
+		return 0;
+	*value = (int) number;
+	return 1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-b corpus_file] [-t] [-T slowest] "
+	        "[-s | -p workers | -w workers [-H] "
+	        "| -x | -c [-M megabytes] [-E replace|keep|costlier] [-z zdd_file] "
+	        "| -k checkpoint_file [-K seconds]]\n", name);
+}
+
+/* Next puzzle into `input` (82 characters). Returns 0 when there are none */
+static int read_puzzle(PuzzleSource *source, char *input)
+{
+	if(source->corpus == NULL)
+		return fscanf(stdin, "%81s", input) == 1;
+	if(source->next >= source->corpus->count)
+		return 0;
+	corpus_puzzle(source->corpus, source->next++, input);
+	return 1;
+}
+
+static void solve_json(PuzzleSource *source, Timing *timing)
 {
 	char input[82];
 	Sudoku *dance_floor = malloc(sizeof(Sudoku));
 	int read_fail;
 	struct sudoku_solution *solution;
+	unsigned long long started = 0;
 
 	initialize_sudoku(dance_floor, ZERO_SUDOKU);
 	while(!feof(stdin)) {
-		read_fail = fscanf(stdin, "%s", input);
-		if(read_fail == EOF)
+		read_fail = !read_puzzle(source, input);
+		if(read_fail)
 			break;
+		if(timing != NULL)
+			started = monotonic_nanoseconds();
 		fill_sudoku(dance_floor, input);
 		solution = solve_sudoku(dance_floor, 2);
+		unfill_sudoku(dance_floor);
+		if(timing != NULL)
+			record_timing(timing, monotonic_nanoseconds() - started,
+			              count_solution_steps(solution->first_step), input);
 		print_solution_json(solution);
+		free_sudoku_solution(solution);
+	}
+
+	free_sudoku(dance_floor);
+}
+
+/* Puzzles are read LANES at a time and propagated together; only those
+ * that propagation alone can't finish go through the dance floor */
+static void solve_batches(PuzzleSource *source, Timing *timing)
+{
+	char inputs[LANES][82];
+	LaneBatch *batch = malloc(sizeof(LaneBatch));
+	void *memory = malloc(sudoku_beast_size());
+	sudoku_beast *beast = sudoku_beast_init(memory, sudoku_beast_size());
+
+	clear_lanes(batch);
+	while(read_puzzle(source, inputs[batch->count])) {
+		if(valid_sudoku(inputs[batch->count]))
+			load_lane(batch, inputs[batch->count]);
+		else
+			load_lane(batch, NULL);
+		if(batch->count == LANES) {
+			finish_batch(batch, inputs, beast, timing);
+			clear_lanes(batch);
+		}
+	}
+	if(batch->count > 0)
+		finish_batch(batch, inputs, beast, timing);
+
+	free(memory);
+	free(batch);
+}
+
+/* When timing, each puzzle is charged an equal share of the batch's
+ * propagation, plus its own dance if it needs one. Only the dance counts as
+ * search nodes */
+static void finish_batch(LaneBatch *batch, char inputs[][82], sudoku_beast *beast,
+                         Timing *timing)
+{
+	char board[82], solution[82];
+	int lane, found;
+	unsigned long long started = 0, share = 0, spent = 0;
+	long searched;
+
+	if(timing != NULL)
+		started = monotonic_nanoseconds();
+	propagate_lanes(batch);
+	if(timing != NULL)
+		share = (monotonic_nanoseconds() - started) / batch->count;
+	for(lane = 0; lane < batch->count; lane++) {
+		spent = share;
+		searched = 0;
+		switch(lane_status(batch, lane)) {
+			case LANE_SOLVED:
+				lane_board(batch, lane, board);
+				printf("%s\n", board);
+				break;
+			case LANE_STUCK:
+				/* what propagation found is implied by the clues, so the
+				 * dance starts from there */
+				lane_board(batch, lane, board);
+				if(timing != NULL)
+					started = monotonic_nanoseconds();
+				found = sudoku_beast_solve(beast, board, solution, NULL, NULL);
+				if(timing != NULL)
+					spent += monotonic_nanoseconds() - started;
+				searched = sudoku_beast_nodes(beast);
+				if(found > 0) {
+					printf("%s\n", solution);
+					break;
+				}
+				/* fall through */
+			default:
+				printf("%s no solution\n", inputs[lane]);
+				break;
+		}
+		if(timing != NULL)
+			record_timing(timing, spent, searched, inputs[lane]);
+	}
+}
+
+/* One line per puzzle: the puzzle and how many solutions it has. The cache
+ * is shared by all puzzles, since they all dance on the same floor. When
+ * writing the DAG each puzzle's root is given on its line too */
+static int count_solutions(PuzzleSource *source, size_t memo_bytes, int policy,
+                           FILE *zdd_out)
+{
+	char input[82];
+	Sudoku *dance_floor = malloc(sizeof(Sudoku));
+	DlxMemo *memo;
+	unsigned long long count;
+	long root;
+
+	initialize_sudoku(dance_floor, ZERO_SUDOKU);
+	memo = new_dlx_memo(dance_floor->master, memo_bytes, policy, zdd_out);
+	if(memo == NULL) {
+		fprintf(stderr, "memo: can't allocate %zu megabytes\n", memo_bytes >> 20);
+		free_sudoku(dance_floor);
+		return -1;
+	}
+	while(read_puzzle(source, input)) {
+		if(!valid_sudoku(input)) {
+			printf("%s 0\n", input);
+			continue;
+		}
+		fill_sudoku(dance_floor, input);
+#ifdef DLX_PROPAGATE
+		dance_floor->iteration = propagate_dlx(dance_floor->master,
+		                                       dance_floor->iteration,
+		                                       dance_floor->solutions,
+		                                       NULL, NULL, NULL);
+#endif
+		count = count_dlx(dance_floor->master, memo, &root);
+		if(zdd_out != NULL)
+			printf("%s %llu %ld\n", input, count, root);
+		else
+			printf("%s %llu\n", input, count);
 		unfill_sudoku(dance_floor);
 	}
 
-	free_sudoku_solution(solution);
+	fprintf(stderr, "memo: %llu hits, %llu misses, %llu evictions\n",
+	        memo->hits, memo->misses, memo->evictions);
+	free_dlx_memo(memo);
 	free_sudoku(dance_floor);
-	
-	return (0);
+	return 0;
+}
+
+/* The checkpoint's tag is the number of the puzzle being searched, so a
+ * resumed run skips the puzzles already done. Standard output is flushed
+ * before every save, so no solution the checkpoint counts can be lost with
+ * the process; solutions printed after the last save are printed again when
+ * resuming. Returns -1 if the checkpoint doesn't fit the input, or if it
+ * can't be saved: the run stops there rather than go on unprotected */
+static int enumerate_solutions(PuzzleSource *source, const char *path, int interval)
+{
+	char input[82];
+	Sudoku *dance_floor = malloc(sizeof(Sudoku));
+	DlxCheckpoint *checkpoint = new_dlx_checkpoint(path, interval, 81);
+	long index = 0;
+	int found = 0;
+
+	checkpoint->flush = flush_stream;
+	checkpoint->flush_data = stdout;
+
+	switch(load_dlx_checkpoint(checkpoint)) {
+		case 1:
+			fprintf(stderr, "resuming puzzle %ld after %llu solutions\n",
+			        checkpoint->tag, checkpoint->solutions);
+			break;
+		case -1:
+			fprintf(stderr, "%s: not a checkpoint\n", path);
+			free_dlx_checkpoint(checkpoint);
+			free(dance_floor);
+			return -1;
+	}
+
+	initialize_sudoku(dance_floor, ZERO_SUDOKU);
+	while(found >= 0 && read_puzzle(source, input)) {
+		if(index < checkpoint->tag || !valid_sudoku(input)) {
+			index++;
+			continue;
+		}
+		if(index > checkpoint->tag) {
+			/* a new puzzle, not the one we resumed */
+			checkpoint->tag = index;
+			checkpoint->solutions = 0;
+			checkpoint->resume = 0;
+		}
+		fill_sudoku(dance_floor, input);
+#ifdef DLX_PROPAGATE
+		dance_floor->iteration = propagate_dlx(dance_floor->master,
+		                                       dance_floor->iteration,
+		                                       dance_floor->solutions,
+		                                       NULL, NULL, NULL);
+#endif
+		fflush(stdout);
+		found = solve_dlx_checkpointed(dance_floor->master, dance_floor->iteration,
+		                               dance_floor->solutions, NULL, NULL,
+		                               print_numbered_solution, &index,
+		                               checkpoint);
+#ifndef DLX_EXHAUSTIVE
+		if(found == 1)
+			dance_floor->iteration = 81;
+#endif
+		unfill_sudoku(dance_floor);
+		index++;
+	}
+
+	if(found == DLX_CHECKPOINT_MISMATCH)
+		fprintf(stderr, "%s: checkpoint doesn't match puzzle %ld\n",
+		        path, checkpoint->tag);
+	else if(found == DLX_CHECKPOINT_UNSAVED)
+		fprintf(stderr, "%s: can't save checkpoint (%s), stopping at puzzle %ld\n",
+		        path, strerror(checkpoint->error), checkpoint->tag);
+	else
+		remove(path);
+	free_dlx_checkpoint(checkpoint);
+	free_sudoku(dance_floor);
+	return found < 0 ? -1 : 0;
+}
+
+static int flush_stream(void *stream)
+{
+	return fflush(stream);
+}
+
+static void print_numbered_solution(Node *acc[], int iteration, void *index)
+{
+	char board[82];
+
+	write_solution_sudoku(acc, board);
+	printf("%ld %s\n", *(long *) index, board);
+}
+
+static void solve_raced(PuzzleSource *source, int workers, Timing *timing)
+{
+	char input[82], solution[82];
+	Portfolio *portfolio = new_portfolio(workers);
+	unsigned long long started = 0;
+	int valid, solved;
+
+	while(read_puzzle(source, input)) {
+		if(timing != NULL)
+			started = monotonic_nanoseconds();
+		valid = valid_sudoku(input);
+		solved = valid && solve_portfolio(portfolio, input, solution);
+		if(timing != NULL)
+			record_timing(timing, monotonic_nanoseconds() - started,
+			              valid ? portfolio_nodes(portfolio) : 0, input);
+		if(solved)
+			printf("%s\n", solution);
+		else
+			printf("%s no solution\n", input);
+	}
+
+	free_portfolio(portfolio);
+}
+
+static void solve_killers(void)
+{
+	char input[82], cages[1024], solution[82];
+	Sudoku *dance_floor = malloc(sizeof(Sudoku));
+	KillerTables *tables = malloc(sizeof(KillerTables));
+	Killer *killer = malloc(sizeof(Killer));
+
+	build_killer_tables(tables);
+	initialize_sudoku(dance_floor, ZERO_SUDOKU);
+	while(fscanf(stdin, "%81s %1023s", input, cages) == 2) {
+		if(parse_killer(killer, tables, cages) < 0)
+			printf("%s %s bad cages\n", input, cages);
+		else if(solve_killer(dance_floor, killer, input, solution) > 0)
+			printf("%s\n", solution);
+		else
+			printf("%s %s no solution\n", input, cages);
+	}
+
+	free(killer);
+	free(tables);
+	free_sudoku(dance_floor);
+}
+
+/* A corpus is handed to the pool as it is, text is read in full first */
+static void solve_pooled(PuzzleSource *source, const PoolOptions *options,
+                         Timing *timing)
+{
+	PoolInput input;
+	char (*text)[82] = NULL;
+	char (*solutions)[82];
+	char puzzle[82];
+	size_t room = 0, i;
+
+	input.corpus = source->corpus;
+	input.count = 0;
+	if(source->corpus != NULL)
+		input.count = source->corpus->count;
+	else {
+		room = 1024;
+		text = malloc(room * sizeof(*text));
+		while(read_puzzle(source, text[input.count])) {
+			if(++input.count == room) {
+				room *= 2;
+				text = realloc(text, room * sizeof(*text));
+			}
+		}
+	}
+	input.text = (const char (*)[82]) text;
+
+	solutions = solve_pool(&input, options, timing);
+	if(solutions == NULL) {
+		perror("solve_pool");
+		free(text);
+		return;
+	}
+	for(i = 0; i < input.count; i++) {
+		if(solutions[i][0] != '\0')
+			printf("%s\n", solutions[i]);
+		else {
+			if(source->corpus != NULL)
+				corpus_puzzle(source->corpus, i, puzzle);
+			else
+				memcpy(puzzle, text[i], 82);
+			printf("%s no solution\n", puzzle);
+		}
+	}
+
+	free_pool_solutions(solutions, input.count);
+	free(text);
+}
+
+static void report_latency(const Timing *timing)
+{
+	const LatencyHistogram *latencies = &timing->histogram;
+	const SlowList *slowest = timing->slowest;
+	int i;
+
+	fprintf(stderr, "%llu puzzles  p50 %.3f ms  p99 %.3f ms  p99.9 %.3f ms  max %.3f ms\n",
+	        latencies->total,
+	        latency_percentile(latencies, 50) / 1e6,
+	        latency_percentile(latencies, 99) / 1e6,
+	        latency_percentile(latencies, 99.9) / 1e6,
+	        latencies->max / 1e6);
+	for(i = 0; i < slowest->count; i++) {
+		fprintf(stderr, "%10.3f ms  ", slowest->puzzles[i].nanoseconds / 1e6);
+		if(slowest->puzzles[i].nodes >= 0)
+			fprintf(stderr, "%8ld nodes  ", slowest->puzzles[i].nodes);
+		else
+			fprintf(stderr, "%8s nodes  ", "?");
+		fprintf(stderr, "%s\n", slowest->puzzles[i].puzzle);
+	}
 }
 
 
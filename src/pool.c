@@ -0,0 +1,251 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h> /* memcpy */
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+#include "pool.h"
+#include "corpus.h"
+#include "sudoku_beast.h"
+
+/* Puzzles taken at a time: small enough to keep every worker busy on short
+ * inputs, while their solutions (3936 bytes) still fit in a 4 KiB page. A
+ * chunk's output spans at most two pages, shared with the chunks next to it,
+ * which are mostly taken by workers on the same socket */
+#define CHUNK 48
+#define HUGE_PAGE ((size_t) 2 << 20)
+#define MAX_SOCKETS 64
+
+/* One per socket, each on its own cache lines */
+struct shard {
+	_Alignas(64) atomic_size_t next;
+	size_t end;
+};
+
+struct pool {
+	const PoolInput *input;
+	Timing *timing;
+	char (*solutions)[82];
+	int huge_pages;
+	int sockets;
+	struct shard shards[MAX_SOCKETS];
+};
+
+struct pool_worker {
+	struct pool *pool;
+	pthread_t thread;
+	int cpu;
+	int socket;
+	Timing *timing;            /* this worker's own, merged once done */
+};
+
+static void *pool_work(void *data);
+static int take_chunk(struct pool *pool, int socket, size_t *first, size_t *last);
+static int cpu_package(int cpu);
+
+/* Solve every puzzle of `input`. Returns one solution per puzzle, in the
+ * same order, an empty string standing for "no solution"; to be released
+ * with free_pool_solutions. Unless `timing` is NULL, every puzzle's solving
+ * time is added to it */
+char (*solve_pool(const PoolInput *input, const PoolOptions *options,
+                  Timing *timing))[82] {
+	struct pool pool;
+	struct pool_worker *workers;
+	cpu_set_t allowed;
+	int cpus[CPU_SETSIZE], packages[CPU_SETSIZE], package_ids[MAX_SOCKETS];
+	int per_socket[MAX_SOCKETS];
+	int *order, *rank;
+	int count = 0, workers_count, cpu, i, s, k, placed;
+	size_t start, share;
+
+	/* The CPUs we may use, and the socket of each */
+	pool.sockets = 0;
+	CPU_ZERO(&allowed);
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+		CPU_SET(0, &allowed);
+	for(cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if(!CPU_ISSET(cpu, &allowed))
+			continue;
+		k = cpu_package(cpu);
+		for(s = 0; s < pool.sockets && package_ids[s] != k; s++)
+			;
+		if(s == pool.sockets) {
+			if(pool.sockets == MAX_SOCKETS)
+				s = 0;
+			else
+				package_ids[pool.sockets++] = k;
+		}
+		cpus[count] = cpu;
+		packages[count] = s;
+		count++;
+	}
+
+	/* Deal CPUs out a socket at a time, so that fewer workers than CPUs
+	 * still spread over every socket: first the first CPU of each socket,
+	 * then the second... */
+	order = malloc(count * sizeof(int));
+	rank = malloc(count * sizeof(int));
+	for(s = 0; s < pool.sockets; s++)
+		per_socket[s] = 0;
+	for(i = 0; i < count; i++)
+		rank[i] = per_socket[packages[i]]++;
+	placed = 0;
+	for(k = 0; placed < count; k++) {
+		for(i = 0; i < count; i++) {
+			if(rank[i] == k)
+				order[placed++] = i;
+		}
+	}
+	free(rank);
+
+	workers_count = options->workers > 0 ? options->workers : count;
+	workers = malloc(workers_count * sizeof(struct pool_worker));
+	for(s = 0; s < pool.sockets; s++)
+		per_socket[s] = 0;
+	for(i = 0; i < workers_count; i++) {
+		workers[i].pool = &pool;
+		workers[i].cpu = cpus[order[i % count]];
+		workers[i].socket = packages[order[i % count]];
+		workers[i].timing = NULL;
+		per_socket[workers[i].socket]++;
+	}
+
+	/* Contiguous shards, as large as the socket's share of workers */
+	start = 0;
+	for(s = 0; s < pool.sockets; s++) {
+		share = input->count * per_socket[s] / workers_count;
+		if(s == pool.sockets - 1)
+			share = input->count - start;
+		atomic_init(&pool.shards[s].next, start);
+		pool.shards[s].end = start + share;
+		start += share;
+	}
+
+	pool.input = input;
+	pool.timing = timing;
+	pool.huge_pages = options->huge_pages;
+	pool.solutions = mmap(NULL, input->count * 82 + 1, PROT_READ | PROT_WRITE,
+	                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pool.solutions == MAP_FAILED) {
+		free(workers);
+		free(order);
+		return NULL;
+	}
+
+	for(i = 0; i < workers_count; i++)
+		pthread_create(&workers[i].thread, NULL, pool_work, workers + i);
+	for(i = 0; i < workers_count; i++) {
+		pthread_join(workers[i].thread, NULL);
+		if(workers[i].timing != NULL) {
+			merge_timing(timing, workers[i].timing);
+			free_timing(workers[i].timing);
+		}
+	}
+
+	free(workers);
+	free(order);
+	return pool.solutions;
+}
+
+void free_pool_solutions(char (*solutions)[82], size_t count) {
+	munmap(solutions, count * 82 + 1);
+}
+
+static void *pool_work(void *data) {
+	struct pool_worker *worker = data;
+	struct pool *pool = worker->pool;
+	const PoolInput *input = pool->input;
+	cpu_set_t cpu;
+	size_t size = sudoku_beast_size(), mapped, first, last, i;
+	unsigned long long started = 0;
+	void *memory, *floor;
+	sudoku_beast *beast;
+	char puzzle[82];
+
+	CPU_ZERO(&cpu);
+	CPU_SET(worker->cpu, &cpu);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu);
+
+	/* Only now, running where it will stay, does the worker touch its
+	 * floor for the first time */
+	mapped = size;
+	if(pool->huge_pages)
+		mapped = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE + HUGE_PAGE;
+	memory = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+	              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(memory == MAP_FAILED)
+		return NULL;
+	floor = memory;
+#ifdef MADV_HUGEPAGE
+	/* The mapping needn't start on a huge page boundary, which is why one
+	 * huge page more than needed was asked for: the floor starts on the
+	 * first boundary in it */
+	if(pool->huge_pages) {
+		floor = (void *) (((uintptr_t) memory + HUGE_PAGE - 1)
+		                  & ~(uintptr_t) (HUGE_PAGE - 1));
+		madvise(floor, mapped - HUGE_PAGE, MADV_HUGEPAGE);
+	}
+#endif
+	beast = sudoku_beast_init(floor, size);
+	if(pool->timing != NULL)
+		worker->timing = new_timing(pool->timing->slowest->size);
+
+	while(take_chunk(pool, worker->socket, &first, &last)) {
+		for(i = first; i < last; i++) {
+			if(input->corpus != NULL)
+				corpus_puzzle(input->corpus, i, puzzle);
+			else
+				memcpy(puzzle, input->text[i], 82);
+			if(worker->timing != NULL)
+				started = monotonic_nanoseconds();
+			if(sudoku_beast_solve(beast, puzzle, pool->solutions[i], NULL, NULL) <= 0)
+				pool->solutions[i][0] = '\0';
+			if(worker->timing != NULL)
+				record_timing(worker->timing, monotonic_nanoseconds() - started,
+				              sudoku_beast_nodes(beast), puzzle);
+		}
+	}
+
+	munmap(memory, mapped);
+	return NULL;
+}
+
+/* Puzzles first to last - 1 are ours to solve. Our own socket's shard
+ * first, then whatever is left elsewhere. Returns 0 when all are taken */
+static int take_chunk(struct pool *pool, int socket, size_t *first, size_t *last) {
+	struct shard *shard;
+	int k;
+
+	for(k = 0; k < pool->sockets; k++) {
+		shard = pool->shards + (socket + k) % pool->sockets;
+		if(atomic_load_explicit(&shard->next, memory_order_relaxed) >= shard->end)
+			continue;
+		*first = atomic_fetch_add(&shard->next, CHUNK);
+		if(*first >= shard->end)
+			continue;
+		*last = *first + CHUNK < shard->end ? *first + CHUNK : shard->end;
+		return 1;
+	}
+	return 0;
+}
+
+/* The socket a CPU sits on, 0 if the kernel won't tell */
+static int cpu_package(int cpu) {
+	char path[96];
+	FILE *in;
+	int package = 0;
+
+	snprintf(path, sizeof(path),
+	         "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+	in = fopen(path, "r");
+	if(in != NULL) {
+		if(fscanf(in, "%d", &package) != 1)
+			package = 0;
+		fclose(in);
+	}
+	return package;
+}
@@ -0,0 +1,32 @@
+#ifndef POOL_H
+#define POOL_H
+#include <stddef.h>
+#include "corpus.h"
+#include "latency.h"
+
+/* Batch solving on a pool of threads, each pinned to one CPU. Puzzles are
+ * split into one contiguous shard per socket, sized by how many workers
+ * run there, and workers take chunks of their own socket's shard before
+ * helping with any other. Every worker builds its dance floor itself after
+ * being pinned, so that first touch puts it in memory local to its socket;
+ * solutions are written to a mapping nobody touched before, one chunk at a
+ * time, so each socket's output pages end up local to it as well, but for
+ * the few pages straddling two shards. */
+
+typedef struct {
+	int workers;    /* 0 for one per CPU we are allowed to run on */
+	int huge_pages; /* ask for transparent huge pages for the floors */
+} PoolOptions;
+
+/* Puzzles come either from a corpus or from text, 82 characters each */
+typedef struct {
+	const Corpus *corpus;
+	const char (*text)[82];
+	size_t count;
+} PoolInput;
+
+char (*solve_pool(const PoolInput *input, const PoolOptions *options,
+                  Timing *timing))[82];
+void free_pool_solutions(char (*solutions)[82], size_t count);
+
+#endif
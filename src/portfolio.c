@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "portfolio.h"
+#include "sudoku.h"
+#include "dlx_config.h"
+#include "dlx.h"
+
+#define TIE_FIRST 0  /* the first of the smallest columns, as choose_column */
+#define TIE_LAST 1   /* the last of them */
+#define TIE_RANDOM 2 /* any of them */
+
+/* Nodes in one unit of the Luby sequence */
+#define LUBY_UNIT 256
+
+struct worker {
+	struct portfolio *portfolio;
+	pthread_t thread;
+	Sudoku *sudoku;
+	int tie_break;
+	int shuffle;          /* try the rows of a column in random order */
+	int restarts;         /* give up and start over following Luby */
+	unsigned long long random;
+	unsigned long budget; /* nodes left before the next restart */
+	long searched;        /* columns chosen on this puzzle, restarts included */
+	Node *rows[81][9];    /* the rows of the column chosen at each level */
+	char board[82];
+};
+
+struct portfolio {
+	int count;
+	struct worker *workers;
+	pthread_mutex_t lock;
+	pthread_cond_t start, finish;
+	unsigned long generation; /* bumped for every puzzle */
+	int running;              /* workers still busy with this puzzle */
+	int quit;
+	char puzzle[81];
+	atomic_int done;          /* set by the winner, stops the rest */
+	int result;
+	long searched;            /* the winner's */
+	char solution[82];
+};
+
+static void *work(void *data);
+static int run(struct worker *worker);
+static int race(struct worker *worker, int iteration);
+static Control *pick_column(struct worker *worker);
+static void count_forced(const Control *column, int iteration, void *searched);
+static unsigned long next_random(struct worker *worker);
+static unsigned long luby(unsigned long i);
+
+/* Start `workers` threads, each with its own dance floor. Worker 0 does the
+ * plain search, worker 1 breaks ties the other way round and the rest
+ * randomize everything with restarts, each from its own seed */
+Portfolio *new_portfolio(int workers) {
+	Portfolio *portfolio = malloc(sizeof(Portfolio));
+	struct worker *worker;
+	int i;
+
+	if(workers < 1)
+		workers = 1;
+	portfolio->count = workers;
+	portfolio->workers = malloc(workers * sizeof(struct worker));
+	pthread_mutex_init(&portfolio->lock, NULL);
+	pthread_cond_init(&portfolio->start, NULL);
+	pthread_cond_init(&portfolio->finish, NULL);
+	portfolio->generation = 0;
+	portfolio->running = 0;
+	portfolio->quit = 0;
+	portfolio->searched = 0;
+	atomic_init(&portfolio->done, 0);
+
+	for(i = 0; i < workers; i++) {
+		worker = portfolio->workers + i;
+		worker->portfolio = portfolio;
+		worker->sudoku = malloc(sizeof(Sudoku));
+		initialize_sudoku(worker->sudoku, ZERO_SUDOKU);
+		worker->tie_break = i == 0 ? TIE_FIRST : (i == 1 ? TIE_LAST : TIE_RANDOM);
+		worker->shuffle = i >= 2;
+		worker->restarts = i >= 2;
+		worker->random = 0x9E3779B97F4A7C15ULL * (i + 1);
+		pthread_create(&worker->thread, NULL, work, worker);
+	}
+	return portfolio;
+}
+
+/* Solve `puzzle`, which must pass valid_sudoku, writing the solution to
+ * `solution` (82 characters). Returns 1 if solved, 0 if there's no
+ * solution. Not to be called from several threads on the same portfolio */
+int solve_portfolio(Portfolio *portfolio, const char *puzzle, char *solution) {
+	pthread_mutex_lock(&portfolio->lock);
+	memcpy(portfolio->puzzle, puzzle, 81);
+	atomic_store(&portfolio->done, 0);
+	portfolio->running = portfolio->count;
+	portfolio->generation++;
+	pthread_cond_broadcast(&portfolio->start);
+	while(portfolio->running > 0)
+		pthread_cond_wait(&portfolio->finish, &portfolio->lock);
+	pthread_mutex_unlock(&portfolio->lock);
+
+	if(portfolio->result)
+		memcpy(solution, portfolio->solution, 82);
+	return portfolio->result;
+}
+
+/* Search nodes, forced ones included, that the winner of the last
+ * solve_portfolio went through, over all its restarts */
+long portfolio_nodes(const Portfolio *portfolio) {
+	return portfolio->searched;
+}
+
+void free_portfolio(Portfolio *portfolio) {
+	int i;
+
+	pthread_mutex_lock(&portfolio->lock);
+	portfolio->quit = 1;
+	pthread_cond_broadcast(&portfolio->start);
+	pthread_mutex_unlock(&portfolio->lock);
+
+	for(i = 0; i < portfolio->count; i++) {
+		pthread_join(portfolio->workers[i].thread, NULL);
+		free_sudoku(portfolio->workers[i].sudoku);
+	}
+	pthread_mutex_destroy(&portfolio->lock);
+	pthread_cond_destroy(&portfolio->start);
+	pthread_cond_destroy(&portfolio->finish);
+	free(portfolio->workers);
+	free(portfolio);
+}
+
+static void *work(void *data) {
+	struct worker *worker = data;
+	struct portfolio *portfolio = worker->portfolio;
+	unsigned long seen = 0;
+	char puzzle[81];
+	int result, racing = 0;
+
+	for(;;) {
+		pthread_mutex_lock(&portfolio->lock);
+		while(portfolio->generation == seen && !portfolio->quit)
+			pthread_cond_wait(&portfolio->start, &portfolio->lock);
+		if(portfolio->quit) {
+			pthread_mutex_unlock(&portfolio->lock);
+			return NULL;
+		}
+		seen = portfolio->generation;
+		memcpy(puzzle, portfolio->puzzle, 81);
+		pthread_mutex_unlock(&portfolio->lock);
+
+		fill_sudoku(worker->sudoku, puzzle);
+		result = run(worker);
+		unfill_sudoku(worker->sudoku);
+
+		/* the winner writes the answer before saying it's done */
+		racing = 0;
+		if(result >= 0 && atomic_compare_exchange_strong(&portfolio->done, &racing, 1)) {
+			portfolio->result = result;
+			portfolio->searched = worker->searched;
+			if(result)
+				memcpy(portfolio->solution, worker->board, 82);
+		}
+
+		pthread_mutex_lock(&portfolio->lock);
+		portfolio->running--;
+		if(portfolio->running == 0)
+			pthread_cond_signal(&portfolio->finish);
+		pthread_mutex_unlock(&portfolio->lock);
+	}
+}
+
+/* Search until finished or beaten, restarting if so configured. Returns 1
+ * if solved, 0 if there's no solution and -1 if another worker won */
+static int run(struct worker *worker) {
+	Sudoku *sudoku = worker->sudoku;
+	unsigned long attempt = 1;
+	int result;
+
+	worker->searched = 0;
+#ifdef DLX_PROPAGATE
+	sudoku->iteration = propagate_dlx(sudoku->master, sudoku->iteration,
+	                                  sudoku->solutions, count_forced, NULL,
+	                                  &worker->searched);
+#endif
+	for(;;) {
+		worker->budget = worker->restarts ? luby(attempt++) * LUBY_UNIT : ULONG_MAX;
+		result = race(worker, sudoku->iteration);
+		if(result >= 0 || atomic_load(&worker->portfolio->done))
+			return result;
+	}
+}
+
+/* The dance of solve_dlx, which always leaves the floor as it found it.
+ * Returns 1 if solved, 0 if there's no solution under this node and -1 if
+ * it had to stop, because another worker won or the budget ran out */
+static int race(struct worker *worker, int iteration) {
+	Control *master = worker->sudoku->master;
+	Node **acc = worker->sudoku->solutions;
+	Node **rows = worker->rows[iteration];
+	Control *column = NULL;
+	Node *row = NULL, *j = NULL;
+	int count, k, pick, found = 0;
+
+	if(atomic_load_explicit(&worker->portfolio->done, memory_order_relaxed))
+		return -1;
+	if(worker->budget-- == 0)
+		return -1;
+
+	if(master->right == master) {
+		write_solution_sudoku(acc, worker->board);
+		return 1;
+	}
+
+	column = pick_column(worker);
+	worker->searched++;
+	cover_column(column);
+	count = 0;
+	for(row = column->node.down; row != &(column->node); row = row->down)
+		rows[count++] = row;
+	if(worker->shuffle) {
+		for(k = count - 1; k > 0; k--) {
+			j = rows[k];
+			pick = next_random(worker) % (k + 1);
+			rows[k] = rows[pick];
+			rows[pick] = j;
+		}
+	}
+
+	for(k = 0; k < count && found == 0; k++) {
+		row = rows[k];
+		acc[iteration] = row;
+		for(j = row->right; j != row; j = j->right)
+			cover_column(j->control);
+
+		found = race(worker, iteration + 1);
+
+		for(j = row->left; j != row; j = j->left)
+			uncover_column(j->control);
+	}
+
+	uncover_column(column);
+	return found;
+}
+
+static void count_forced(const Control *column, int iteration, void *searched) {
+	(*(long *) searched)++;
+}
+
+/* choose_column, with the worker's way of breaking ties */
+static Control *pick_column(struct worker *worker) {
+	Control *master = worker->sudoku->master;
+	Control *ret = master->right;
+	Control *j;
+	int s = INT_MAX, ties = 0;
+
+	for(j = master->right; j != master; j = j->right) {
+		if(j->size < s) {
+			ret = j;
+			s = j->size;
+			ties = 1;
+		}
+		else if(j->size == s) {
+			ties++;
+			if(worker->tie_break == TIE_LAST
+			   || (worker->tie_break == TIE_RANDOM && next_random(worker) % ties == 0))
+				ret = j;
+		}
+	}
+	return ret;
+}
+
+/* xorshift64*, private to the worker so no locking is needed */
+static unsigned long next_random(struct worker *worker) {
+	worker->random ^= worker->random >> 12;
+	worker->random ^= worker->random << 25;
+	worker->random ^= worker->random >> 27;
+	return (unsigned long) ((worker->random * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/* 1, 1, 2, 1, 1, 2, 4, 1, 1, 2, 1, 1, 2, 4, 8, ... (i counts from 1) */
+static unsigned long luby(unsigned long i) {
+	unsigned long size, power;
+
+	for(;;) {
+		size = 1;
+		power = 1;
+		while(size < i) {
+			size = 2*size + 1;
+			power *= 2;
+		}
+		if(size == i)
+			return power;
+		i -= (size + 1) / 2 - 1;
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+/* Several differently configured searches race on the same puzzle, each on
+ * its own dance floor and thread, and the first to finish wins. One of
+ * them is always the plain search, so the race is never slower than it by
+ * more than the cost of running alongside; the others break ties between
+ * columns differently, try rows in random order and restart following the
+ * Luby sequence, which cuts the cases where one unlucky choice near the top
+ * costs a thousand times the usual effort. */
+
+typedef struct portfolio Portfolio;
+
+Portfolio *new_portfolio(int workers);
+int solve_portfolio(Portfolio *portfolio, const char *puzzle, char *solution);
+long portfolio_nodes(const Portfolio *portfolio);
+void free_portfolio(Portfolio *portfolio);
+
+#endif
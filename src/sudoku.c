@@ -1,10 +1,11 @@
 #include <stdlib.h>
 #include <stdio.h>
-#include <string.h> /* memcpy */
+#include <string.h> /* memcpy, memset */
 
 #include "sudoku.h"
 #include "sudoku_solutions.h"
 #include "dlx.h"
+#include "dlc.h"
 
 void initialize_sudoku(Sudoku *sudoku, const char *setup) {
 	/* The fact that we're allocating space for many row controllers
@@ -13,6 +14,15 @@ void initialize_sudoku(Sudoku *sudoku, const char *setup) {
 	Control *columns = malloc(324*sizeof(Control));
 	Node *nodes = malloc(729*4*sizeof(Node));
 	Control *master = malloc(sizeof(Control));
+
+	initialize_sudoku_with(sudoku, setup, master, columns, nodes);
+}
+
+/* Same as `initialize_sudoku`, but the dance floor is built in memory the
+ * caller owns: `columns` must hold 324 controls and `nodes` 2916 nodes.
+ * Nothing is allocated, so `free_sudoku` must not be used on the result */
+void initialize_sudoku_with(Sudoku *sudoku, const char *setup,
+                            Control *master, Control *columns, Node *nodes) {
 	int i, col, row, n;
 	Node *rightmost = NULL, *current_node, *j;
 
@@ -89,18 +99,60 @@ void fill_sudoku(Sudoku *sudoku, char *to_fill) {
 	memcpy(sudoku->setup, to_fill, 81);
 }
 
+/* Run the search on a filled sudoku with arbitrary callbacks. Afterwards
+ * `sudoku->iteration` is the number of rows still covered on the floor
+ * (clues, forced rows if DLX_PROPAGATE is set, or the whole solution), so
+ * `unfill_sudoku` knows how far to work backwards. Returns whatever
+ * `solve_dlx` returned */
+int solve_sudoku_with(Sudoku *sudoku,
+                      void (*column_chosen_callback)(const Control *, int, void *),
+                      void (*row_chosen_callback)(const Node *, int, void *),
+                      void (*solution_callback)(Node * [], int, void *),
+                      void *callback_data) {
+	int solved;
+#ifdef DLX_CELLS
+	Cells *cells;
+#endif
+
+#ifdef DLX_PROPAGATE
+	sudoku->iteration = propagate_dlx(sudoku->master, sudoku->iteration,
+	                                  sudoku->solutions,
+	                                  column_chosen_callback,
+	                                  row_chosen_callback, callback_data);
+#endif
+#ifdef DLX_CELLS
+	/* The search runs on a copy, the floor itself is left as it was */
+	cells = cells_from_dlx(sudoku->master);
+	solved = solve_cells(cells, sudoku->iteration, sudoku->solutions,
+	                     column_chosen_callback,
+	                     row_chosen_callback,
+	                     solution_callback, callback_data);
+	free_cells(cells);
+#else
+	solved = solve_dlx(sudoku->master, sudoku->iteration, sudoku->solutions,
+	                   column_chosen_callback,
+	                   row_chosen_callback,
+	                   solution_callback, callback_data);
+#ifndef DLX_EXHAUSTIVE
+	/* A short-circuited search leaves the whole solution covered */
+	if(solved)
+		sudoku->iteration = 81;
+#endif
+#endif
+	return solved;
+}
+
 struct sudoku_solution * solve_sudoku(Sudoku *sudoku, int verbosity) {
 	struct sudoku_solution *ret = NULL;
 	char *c;
 	if(verbosity <= 0) 
-		solve_dlx(sudoku->master, sudoku->iteration, sudoku->solutions,
-	      	      NULL, NULL,
-	              print_solution_sudoku, NULL);
+		solve_sudoku_with(sudoku, NULL, NULL,
+		                  print_solution_sudoku, NULL);
 	if(verbosity == 1) 
-		solve_dlx(sudoku->master, sudoku->iteration, sudoku->solutions,
-	              print_column_choice,
-	              print_row_choice,
-	              print_solution_sudoku, NULL);
+		solve_sudoku_with(sudoku,
+		                  print_column_choice,
+		                  print_row_choice,
+		                  print_solution_sudoku, NULL);
 	if(verbosity >= 2) {
 		ret = malloc(sizeof(struct sudoku_solution));
 		memcpy(ret->puzzle, sudoku->setup, 81);
@@ -110,53 +162,60 @@ struct sudoku_solution * solve_sudoku(Sudoku *sudoku, int verbosity) {
 			if(*c > '0' && *c <= '9') (ret->already_filled)++;
 		}
 		ret->first_step = NULL;
-		solve_dlx(sudoku->master, sudoku->iteration, sudoku->solutions,
-	              record_column_choice,
-	              record_row_choice,
-	              record_solution_sudoku, (void*) ret);
+		solve_sudoku_with(sudoku,
+		                  record_column_choice,
+		                  record_row_choice,
+		                  record_solution_sudoku, (void*) ret);
 	}
 	return ret;
 }
 
 
-/* Unfill sudoku is different depending on whether solving short-circuited
- * or not (i.e. whether DLX_EXHAUSTIVE is set). If DLX_EHAUSTIVE is set, 
- * solving yields back the same sudoku we started with, but if we short-circuited
- * solving returns a solved sudoku, and we have to work backwards from the
- * solution */
-
-#ifdef DLX_EXHAUSTIVE
+/* Unfill sudoku works backwards from whatever is still covered. If
+ * DLX_EXHAUSTIVE is set (or the sudoku had no solution) solving yields back
+ * the same sudoku we started with, but if we short-circuited solving returns
+ * a solved sudoku and `solve_sudoku_with` has recorded the deeper path */
 void unfill_sudoku(Sudoku *sudoku) {
-	Node *current_node;
 	int i;
 
-	for(i = 80; i >= 0; i--) {
-		if(sudoku->setup[i] > '0' && sudoku->setup[i] <= '9') {
-			current_node = sudoku->nodes + node_for(i/9, i%9, sudoku->setup[i] - '0');
-			uncover_row(current_node);
-		}
+	for(i = sudoku->iteration - 1; i >= 0; i--) {
+		uncover_row(sudoku->solutions[i]);
 	}
 
 	sudoku->iteration = 0;
 	memcpy(sudoku->setup, ZERO_SUDOKU, 81);
 }
 
-#else
-void unfill_sudoku(Sudoku *sudoku) {
-	Node *current_node;
-	int i;
+/* Covering a row whose constraints are already covered would corrupt the
+ * dance floor, so clues should be checked against each other before filling
+ * a puzzle that might not be valid. Also fails if setup is shorter than 81 */
+int valid_sudoku(const char *setup) {
+	char used[324];
+	int constraints[4];
+	int i, k, row, col, n;
 
-	for(i = 80; i >= 0; i--) {
-		current_node = sudoku->solutions[i];
-		uncover_row(current_node);
+	memset(used, 0, sizeof(used));
+	for(i = 0; i < 81; i++) {
+		if(setup[i] == '\0')
+			return 0;
+		if(setup[i] <= '0' || setup[i] > '9')
+			continue;
+		row = i/9;
+		col = i%9;
+		n = setup[i] - '0';
+		constraints[0] = case_constraint(col, row);
+		constraints[1] = row_constraint(n, row);
+		constraints[2] = column_constraint(n, col);
+		constraints[3] = square_constraint(n, row, col);
+		for(k = 0; k < 4; k++) {
+			if(used[constraints[k]])
+				return 0;
+			used[constraints[k]] = 1;
+		}
 	}
-
-	sudoku->iteration = 0;
-	memcpy(sudoku->setup, ZERO_SUDOKU, 81);
+	return 1;
 }
 
-#endif
-
 int case_constraint(int col, int row) {
 	/* We will use the first 81 rows for this constraint, listing left to right,
 	 * top to bottom */
@@ -220,7 +279,12 @@ void print_solution_sudoku(Node *acc[], int iteration, void * not_used) {
 }
 
 void record_solution_sudoku(Node *acc[], int iteration, void * sol) {
-	char *sudoku = ((struct sudoku_solution*) sol)->solved;
+	write_solution_sudoku(acc, ((struct sudoku_solution*) sol)->solved);
+}
+
+/* Write the board described by the 81 rows in acc as a string of digits.
+ * `sudoku` must have room for 82 characters */
+void write_solution_sudoku(Node *acc[], char *sudoku) {
 	Node *current;
 	int i, pos;
 	
@@ -238,31 +302,48 @@ void record_solution_sudoku(Node *acc[], int iteration, void * sol) {
 }
 
 void print_column_choice(const Control *column, int iteration, void * not_used) {
+	char line[SUDOKU_TRACE_LINE];
+
+	format_column_choice(line, sizeof(line), column, iteration);
+	fputs(line, stdout);
+}
+
+/* Describe the constraint we're about to satisfy as one line of text,
+ * snprintf style: returns the length the full line would have */
+int format_column_choice(char *line, size_t length,
+                         const Control *column, int iteration) {
 	int label = column->name;
 	int options = column->size;
+	char choices[64];
+
+	if(options == 0)
+		snprintf(choices, sizeof(choices), "(No candidates, we must backtrack)");
+	else if(options == 1)
+		snprintf(choices, sizeof(choices), "(Only 1 candidate, our choice is forced)");
+	else
+		snprintf(choices, sizeof(choices),
+		         "(%d possible choices, we might have to backtrack here)", options);
+
 	if(label < 81) {
-		printf("%d\tThere must be a number in row %d, column %d ",
-		       iteration, label/9 +1, (label%9) + 1);
+		return snprintf(line, length,
+		                "%d\tThere must be a number in row %d, column %d %s\n",
+		                iteration, label/9 +1, (label%9) + 1, choices);
 	}
 	else if(label < 162) {
-		printf("%d\tThere must be a %d in row %d ",
-		       iteration, ((label-81) % 9) + 1, ((label-81)/9) + 1);
+		return snprintf(line, length,
+		                "%d\tThere must be a %d in row %d %s\n",
+		                iteration, ((label-81) % 9) + 1, ((label-81)/9) + 1, choices);
 	}
 	else if(label < 243) {
-		printf("%d\tThere must be a %d in column %d ",
-		       iteration, ((label-162) % 9) + 1, ((label-162)/9) + 1);
+		return snprintf(line, length,
+		                "%d\tThere must be a %d in column %d %s\n",
+		                iteration, ((label-162) % 9) + 1, ((label-162)/9) + 1, choices);
 	}
 	else {
-		printf("%d\tThere must be a %d in square number %d ",
-		       iteration, ((label-243) % 9) + 1, ((label-243)/9) + 1);
+		return snprintf(line, length,
+		                "%d\tThere must be a %d in square number %d %s\n",
+		                iteration, ((label-243) % 9) + 1, ((label-243)/9) + 1, choices);
 	}
-
-	if(options == 0)
-		printf("(No candidates, we must backtrack)\n");
-	else if(options == 1)
-		printf("(Only 1 candidate, our choice is forced)\n");
-	else
-		printf("(%d possible choices, we might have to backtrack here)\n", options);
 }
 
 void record_column_choice(const Control *column, int iteration, void * sln) {
@@ -312,6 +393,13 @@ void record_column_choice(const Control *column, int iteration, void * sln) {
 }
 
 void print_row_choice(const Node *row, int iteration, void * not_used) {
+	char line[SUDOKU_TRACE_LINE];
+
+	format_row_choice(line, sizeof(line), row, iteration);
+	fputs(line, stdout);
+}
+
+int format_row_choice(char *line, size_t length, const Node *row, int iteration) {
 	const Node *current = row;
 	int pos, n;
 	while(current->control->name >= 81) {
@@ -319,8 +407,8 @@ void print_row_choice(const Node *row, int iteration, void * not_used) {
 	}
 	pos = current->control->name;
 	n = (current->right->control->name % 9) + 1;
-	printf("%d\t\tWe put a %d in row %d, column %d\n",
-	       iteration, n, pos/9 + 1, (pos%9) + 1);
+	return snprintf(line, length, "%d\t\tWe put a %d in row %d, column %d\n",
+	                iteration, n, pos/9 + 1, (pos%9) + 1);
 }
 
 void record_row_choice(const Node *row, int iteration, void * sln) {
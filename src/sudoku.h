@@ -1,9 +1,12 @@
 #ifndef SUDOKU_H
 #define SUDOKU_H
+#include <stddef.h>
 #include "dlx.h"
 #include "dlx_config.h"
 
 #define ZERO_SUDOKU "000000000000000000000000000000000000000000000000000000000000000000000000000000000"
+/* Large enough for any line produced by the format_* functions */
+#define SUDOKU_TRACE_LINE 128
 
 typedef struct {
 	Control *master;
@@ -15,9 +18,17 @@ typedef struct {
 } Sudoku;
 
 void initialize_sudoku(Sudoku *sudoku, const char *setup);
+void initialize_sudoku_with(Sudoku *sudoku, const char *setup,
+                            Control *master, Control *columns, Node *nodes);
 void fill_sudoku(Sudoku *sudoku, char *to_fill);
 struct sudoku_solution *solve_sudoku(Sudoku *, int);
+int solve_sudoku_with(Sudoku *sudoku,
+                      void (*column_chosen_callback)(const Control *, int, void *),
+                      void (*row_chosen_callback)(const Node *, int, void *),
+                      void (*solution_callback)(Node * [], int, void *),
+                      void *callback_data);
 void unfill_sudoku(Sudoku *sudoku);
+int valid_sudoku(const char *setup);
 int case_constraint(int col, int row);
 int row_constraint(int n, int row);
 int column_constraint(int n, int col);
@@ -26,10 +37,14 @@ int node_for(int row, int col, int n);
 void free_sudoku(Sudoku*);
 void print_solution_sudoku(Node *acc[], int iteration, void *);
 void record_solution_sudoku(Node *acc[], int iteration, void *);
+void write_solution_sudoku(Node *acc[], char *sudoku);
 void print_column_choice(const Control *column, int iteration, void *);
 void print_row_choice(const Node *row, int iteration, void *);
 void record_column_choice(const Control *column, int iteration, void *);
 void record_row_choice(const Node *row, int iteration, void *);
+int format_column_choice(char *line, size_t length,
+                         const Control *column, int iteration);
+int format_row_choice(char *line, size_t length, const Node *row, int iteration);
 
 
 #endif
@@ -0,0 +1,124 @@
+#include "sudoku_beast.h"
+#include "sudoku.h"
+#include "dlx.h"
+
+struct sudoku_beast {
+	Sudoku sudoku;
+	Control master;
+	Control columns[324];
+	Node nodes[729*4];
+	long searched;   /* search nodes of the last solve */
+};
+
+/* Everything the callbacks need to know about the current call */
+struct beast_call {
+	sudoku_beast_sink trace;
+	void *sink_data;
+	char *solution;
+	int found;
+	long searched;
+};
+
+static void beast_column_choice(const Control *column, int iteration, void *call_data);
+static void beast_column_count(const Control *column, int iteration, void *call_data);
+static void beast_row_choice(const Node *row, int iteration, void *call_data);
+static void beast_solution(Node *acc[], int iteration, void *call_data);
+
+/* Number of bytes `sudoku_beast_init` needs */
+size_t sudoku_beast_size(void) {
+	return sizeof(struct sudoku_beast);
+}
+
+/* Build a solver inside `memory`, which must be at least
+ * `sudoku_beast_size()` bytes and aligned as malloc would align it. The
+ * caller keeps ownership of the memory; there is nothing to free besides
+ * it. Returns NULL if the block is too small */
+sudoku_beast *sudoku_beast_init(void *memory, size_t size) {
+	sudoku_beast *beast = memory;
+
+	if(memory == NULL || size < sizeof(struct sudoku_beast))
+		return NULL;
+
+	initialize_sudoku_with(&beast->sudoku, ZERO_SUDOKU,
+	                       &beast->master, beast->columns, beast->nodes);
+	beast->searched = 0;
+	return beast;
+}
+
+/* Solve the 81 character `puzzle` (digits 1 to 9 are clues, anything else is
+ * an empty cell). The first solution found is written to `solution`, which
+ * must have room for 82 characters. If `trace` is not NULL every step of the
+ * search is sent to it.
+ *
+ * Returns the number of solutions found (at most 1 unless built with
+ * DLX_EXHAUSTIVE), or SUDOKU_BEAST_INVALID if two clues contradict each
+ * other. Either way the solver is ready for the next puzzle afterwards, and
+ * sudoku_beast_nodes tells how much searching this one took */
+int sudoku_beast_solve(sudoku_beast *beast, const char *puzzle, char *solution,
+                       sudoku_beast_sink trace, void *sink_data) {
+	struct beast_call call;
+	char setup[81];
+	int i;
+
+	beast->searched = 0;
+	if(!valid_sudoku(puzzle))
+		return SUDOKU_BEAST_INVALID;
+
+	for(i = 0; i < 81; i++)
+		setup[i] = (puzzle[i] > '0' && puzzle[i] <= '9') ? puzzle[i] : '0';
+
+	call.trace = trace;
+	call.sink_data = sink_data;
+	call.solution = solution;
+	call.found = 0;
+	call.searched = 0;
+
+	fill_sudoku(&beast->sudoku, setup);
+	if(trace != NULL)
+		solve_sudoku_with(&beast->sudoku, beast_column_choice, beast_row_choice,
+		                  beast_solution, &call);
+	else
+		solve_sudoku_with(&beast->sudoku, beast_column_count, NULL,
+		                  beast_solution, &call);
+	unfill_sudoku(&beast->sudoku);
+	beast->searched = call.searched;
+
+	return call.found;
+}
+
+/* Search nodes, forced ones included, that the last sudoku_beast_solve went
+ * through: one for every column it chose */
+long sudoku_beast_nodes(const sudoku_beast *beast) {
+	return beast->searched;
+}
+
+static void beast_column_choice(const Control *column, int iteration, void *call_data) {
+	struct beast_call *call = call_data;
+	char line[SUDOKU_TRACE_LINE];
+	int length = format_column_choice(line, sizeof(line), column, iteration);
+
+	call->searched++;
+	call->trace(line, (size_t) length, call->sink_data);
+}
+
+static void beast_column_count(const Control *column, int iteration, void *call_data) {
+	struct beast_call *call = call_data;
+
+	call->searched++;
+}
+
+static void beast_row_choice(const Node *row, int iteration, void *call_data) {
+	struct beast_call *call = call_data;
+	char line[SUDOKU_TRACE_LINE];
+	int length = format_row_choice(line, sizeof(line), row, iteration);
+
+	call->trace(line, (size_t) length, call->sink_data);
+}
+
+static void beast_solution(Node *acc[], int iteration, void *call_data) {
+	struct beast_call *call = call_data;
+
+	if(call->found == 0)
+		write_solution_sudoku(acc, call->solution);
+	call->found++;
+}
@@ -0,0 +1,25 @@
+#ifndef SUDOKU_BEAST_H
+#define SUDOKU_BEAST_H
+#include <stddef.h>
+
+/* Embeddable interface to the solver. Everything the solver needs lives in
+ * a block of memory the caller hands over, there is no global state and
+ * nothing is ever written to stdout, so separate handles can be used from
+ * separate threads at the same time. */
+
+#define SUDOKU_BEAST_INVALID (-1)
+
+typedef struct sudoku_beast sudoku_beast;
+
+/* Receives the trace of the search, one line at a time (the same lines the
+ * command line prints at verbosity 1). `line` is only valid during the
+ * call and is NUL terminated. */
+typedef void (*sudoku_beast_sink)(const char *line, size_t length, void *sink_data);
+
+size_t sudoku_beast_size(void);
+sudoku_beast *sudoku_beast_init(void *memory, size_t size);
+int sudoku_beast_solve(sudoku_beast *beast, const char *puzzle, char *solution,
+                       sudoku_beast_sink trace, void *sink_data);
+long sudoku_beast_nodes(const sudoku_beast *beast);
+
+#endif
@@ -22,6 +22,20 @@ void free_solution_choice(struct solution_choice* choice) {
 	free(choice);
 }
 
+/* Number of steps taken looking for the solution, backtracked ones
+ * included: one per node of the search tree that isn't a solution */
+long count_solution_steps(struct solution_step *step) {
+	struct solution_choice *choice;
+	long steps;
+
+	if(step == NULL)
+		return 0;
+	steps = 1;
+	for(choice = step->first_choice; choice != NULL; choice = choice->next_choice)
+		steps += count_solution_steps(choice->continuation);
+	return steps;
+}
+
 void print_solution_json(struct sudoku_solution *solution) {
 	printf("{ \"puzzle\" : \"%s\",\n", solution->puzzle);
 	printf("{ \"solution\" : \"%s\",\n", solution->solved);
@@ -51,6 +51,7 @@ struct solution_step {
 void free_sudoku_solution(struct sudoku_solution* solution);
 void free_solution_step(struct solution_step* step);
 void free_solution_choice(struct solution_choice* choice);
+long count_solution_steps(struct solution_step *step);
 void print_solution_json(struct sudoku_solution *solution);
 void print_step_json(struct solution_step *step);
 void print_choices_json(struct solution_choice *choice);
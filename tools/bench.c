@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dlx_config.h"
+#include "dlx.h"
+#include "dlc.h"
+#include "sudoku.h"
+
+/* Compare the exact cover backends: dancing links (dlx.c) and dancing
+ * cells (dlc.c).
+ *
+ * Usage: bench [-r repeats] [-l langford_n] < puzzles
+ *
+ * Every puzzle read from stdin is solved `repeats` times with each backend,
+ * then the Langford pairs problem of order n is solved as a generic
+ * `from_matrix` instance (n = 9 and n = 10 have no solution, so the whole
+ * search tree gets explored even without DLX_EXHAUSTIVE). */
+
+struct bench_count {
+	long solutions;
+	char board[82];
+};
+
+static double seconds(void);
+static void count_solution(Node *acc[], int iteration, void *count);
+static void count_sudoku(Node *acc[], int iteration, void *count);
+static Control *langford(int n);
+
+int main(int argc, char *argv[])
+{
+	int repeats = 10, order = 10;
+	char (*puzzles)[82] = malloc(100000*sizeof(*puzzles));
+	int count = 0, i, r;
+	Sudoku *sudoku = malloc(sizeof(Sudoku));
+	Cells *cells;
+	Control *master;
+	Node *acc[64];
+	struct bench_count links, dancing_cells;
+	double t, links_time, cells_time;
+
+	for(i = 1; i + 1 < argc; i += 2) {
+		if(strcmp(argv[i], "-r") == 0)
+			repeats = atoi(argv[i + 1]);
+		else if(strcmp(argv[i], "-l") == 0)
+			order = atoi(argv[i + 1]);
+	}
+
+	while(count < 100000 && fscanf(stdin, "%81s", puzzles[count]) == 1)
+		count++;
+
+	initialize_sudoku(sudoku, ZERO_SUDOKU);
+	memset(&links, 0, sizeof(links));
+	memset(&dancing_cells, 0, sizeof(dancing_cells));
+
+	t = seconds();
+	for(r = 0; r < repeats; r++) {
+		for(i = 0; i < count; i++) {
+			fill_sudoku(sudoku, puzzles[i]);
+#ifdef DLX_PROPAGATE
+			sudoku->iteration = propagate_dlx(sudoku->master, sudoku->iteration,
+			                                  sudoku->solutions, NULL, NULL, NULL);
+#endif
+#ifdef DLX_EXHAUSTIVE
+			solve_dlx(sudoku->master, sudoku->iteration, sudoku->solutions,
+			          NULL, NULL, count_sudoku, &links);
+#else
+			if(solve_dlx(sudoku->master, sudoku->iteration, sudoku->solutions,
+			             NULL, NULL, count_sudoku, &links))
+				sudoku->iteration = 81;
+#endif
+			unfill_sudoku(sudoku);
+		}
+	}
+	links_time = seconds() - t;
+
+	t = seconds();
+	for(r = 0; r < repeats; r++) {
+		for(i = 0; i < count; i++) {
+			fill_sudoku(sudoku, puzzles[i]);
+#ifdef DLX_PROPAGATE
+			sudoku->iteration = propagate_dlx(sudoku->master, sudoku->iteration,
+			                                  sudoku->solutions, NULL, NULL, NULL);
+#endif
+			cells = cells_from_dlx(sudoku->master);
+			solve_cells(cells, sudoku->iteration, sudoku->solutions,
+			            NULL, NULL, count_sudoku, &dancing_cells);
+			free_cells(cells);
+			unfill_sudoku(sudoku);
+		}
+	}
+	cells_time = seconds() - t;
+
+	printf("sudoku, %d puzzles x %d\n", count, repeats);
+	printf("  links: %8.3f s  %ld solutions\n", links_time, links.solutions);
+	printf("  cells: %8.3f s  %ld solutions\n", cells_time, dancing_cells.solutions);
+
+	memset(&links, 0, sizeof(links));
+	memset(&dancing_cells, 0, sizeof(dancing_cells));
+	master = langford(order);
+
+	t = seconds();
+	solve_dlx(master, 0, acc, NULL, NULL, count_solution, &links);
+	links_time = seconds() - t;
+
+	t = seconds();
+	cells = cells_from_dlx(master);
+	solve_cells(cells, 0, acc, NULL, NULL, count_solution, &dancing_cells);
+	free_cells(cells);
+	cells_time = seconds() - t;
+
+	printf("langford pairs, n = %d\n", order);
+	printf("  links: %8.3f s  %ld solutions\n", links_time, links.solutions);
+	printf("  cells: %8.3f s  %ld solutions\n", cells_time, dancing_cells.solutions);
+
+	free_dlx(master);
+	free_sudoku(sudoku);
+	free(puzzles);
+	return (0);
+}
+
+static double seconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void count_solution(Node *acc[], int iteration, void *count)
+{
+	((struct bench_count *) count)->solutions++;
+}
+
+static void count_sudoku(Node *acc[], int iteration, void *count)
+{
+	struct bench_count *c = count;
+
+	write_solution_sudoku(acc, c->board);
+	c->solutions++;
+}
+
+/* Place two copies of each of 1..n in 2n slots so that the copies of k have
+ * exactly k slots between them. Columns 0..n-1 are the numbers, n..3n-1 the
+ * slots */
+static Control *langford(int n)
+{
+	int columns = 3*n;
+	int *matrix = calloc(n*2*n*columns, sizeof(int));
+	int *labels = malloc(columns*sizeof(int));
+	int rows = 0, k, slot;
+	Control *master;
+
+	for(k = 0; k < columns; k++)
+		labels[k] = k;
+	for(k = 1; k <= n; k++) {
+		for(slot = 0; slot + k + 1 < 2*n; slot++) {
+			matrix[rows*columns + (k - 1)] = 1;
+			matrix[rows*columns + n + slot] = 1;
+			matrix[rows*columns + n + slot + k + 1] = 1;
+			rows++;
+		}
+	}
+
+	master = from_matrix(matrix, rows, columns, labels);
+	free(matrix);
+	free(labels);
+	return master;
+}
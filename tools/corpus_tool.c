@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "corpus.h"
+
+/* Convert between text puzzles (one per line, as read by sudoku-beast) and
+ * packed corpora (see corpus.h).
+ *
+ * Usage: corpus_tool pack corpus_file < puzzles
+ *        corpus_tool unpack corpus_file > puzzles
+ *
+ * Packing needs a real file to write to, since the header holding the count
+ * is filled in once every puzzle has been written */
+
+static int pack(const char *path);
+static int unpack(const char *path);
+
+int main(int argc, char *argv[])
+{
+	if(argc == 3 && strcmp(argv[1], "pack") == 0)
+		return pack(argv[2]);
+	if(argc == 3 && strcmp(argv[1], "unpack") == 0)
+		return unpack(argv[2]);
+	fprintf(stderr, "usage: %s pack|unpack corpus_file\n", argv[0]);
+	return 1;
+}
+
+static int pack(const char *path)
+{
+	char input[82];
+	unsigned char record[CORPUS_RECORD];
+	FILE *out = fopen(path, "wb");
+	size_t count = 0;
+	int failed;
+
+	if(out == NULL) {
+		perror(path);
+		return 1;
+	}
+
+	failed = write_corpus_header(out, 0);
+	while(!failed && fscanf(stdin, "%81s", input) == 1) {
+		if(strlen(input) < 81) {
+			fprintf(stderr, "skipping short line %s\n", input);
+			continue;
+		}
+		pack_puzzle(input, record);
+		failed = fwrite(record, CORPUS_RECORD, 1, out) != 1;
+		count++;
+	}
+
+	if(!failed)
+		failed = fseek(out, 0, SEEK_SET) != 0 || write_corpus_header(out, count) != 0;
+	failed |= fclose(out) != 0;
+	if(failed) {
+		perror(path);
+		return 1;
+	}
+	fprintf(stderr, "%lu puzzles packed\n", (unsigned long) count);
+	return 0;
+}
+
+static int unpack(const char *path)
+{
+	Corpus corpus;
+	char puzzle[82];
+	size_t i;
+
+	if(open_corpus(&corpus, path) < 0) {
+		fprintf(stderr, "%s: not a readable corpus\n", path);
+		return 1;
+	}
+	for(i = 0; i < corpus.count; i++) {
+		corpus_puzzle(&corpus, i, puzzle);
+		printf("%s\n", puzzle);
+	}
+	close_corpus(&corpus);
+	return 0;
+}